@@ -0,0 +1,280 @@
+#include "parity_checking.hpp"
+#include "parity_kernels.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+Google Benchmark suite for the ParityChecking library, e.g.
+  g++ -std=c++20 -O2 -pthread bench_main.cc parity_checking.cc parity_kernels.cc -lbenchmark -o bench
+  ./bench --benchmark_filter='Construct/.*'
+Throughput benchmarks report bytes_per_second (of the byte array) alongside the ns/op times.
+Each byte array benchmark is swept over shapes and over sizes of 1 KB to 1 GB:
+  shape 0 (square)      B == N (or B == 2N)
+  shape 1 (tall-skinny) N == 16 cols of B == size / 16 bytes
+  shape 2 (short-wide)  B == 16 bytes per col, N == size / 16 cols
+given as the (shape, log2 size) args. The largest sizes need a couple of GB of memory, so
+--benchmark_filter them out on small machines.
+*/
+
+using ParityChecking::ParityHdr;
+
+namespace {
+    constexpr int SQUARE{ 0 }, TALL{ 1 }, WIDE{ 2 };
+    constexpr int MIN_LOG2_SIZE{ 10 }, MAX_LOG2_SIZE{ 30 };
+
+    struct Shape {
+        std::uint32_t B;
+        std::uint32_t N;
+        std::size_t size() const { return std::size_t{ B } * N; }
+    };
+
+    Shape shape_of(const benchmark::State& state) {
+        int log2_size = static_cast<int>(state.range(1));
+        std::size_t size = std::size_t{ 1 } << log2_size;
+        switch (state.range(0)) {
+        case TALL:
+            return { static_cast<std::uint32_t>(size / 16), 16 };
+        case WIDE:
+            return { 16, static_cast<std::uint32_t>(size / 16) };
+        default:
+            return { std::uint32_t{ 1 } << (log2_size + 1) / 2, std::uint32_t{ 1 } << log2_size / 2 };
+        }
+    }
+
+    const char* shape_label(const benchmark::State& state) {
+        switch (state.range(0)) {
+        case TALL: return "tall-skinny";
+        case WIDE: return "short-wide";
+        default: return "square";
+        }
+    }
+
+    const unsigned char* byte_array(std::size_t size) {
+        /* Random bytes, kept between benchmarks (only regenerated when a larger array is needed),
+           as generating a GB costs far more than any one benchmark. */
+        static std::vector<unsigned char> bytes;
+        if (bytes.size() < size) {
+            bytes.resize(size);
+            std::mt19937_64 gen{ 1 };
+            for (std::size_t k = 0; k + 8 <= size; k += 8) {
+                std::uint64_t w = gen();
+                std::memcpy(bytes.data() + k, &w, 8);
+            }
+        }
+        return bytes.data();
+    }
+
+    void flip_random_bits(unsigned char* t, std::size_t size, int n_flips, std::mt19937_64& gen) {
+        for (int f = 0; f < n_flips; ++f) {
+            std::size_t bit = gen() % (8 * size);
+            t[bit / 8] ^= 0x80 >> bit % 8;
+        }
+    }
+
+    void shapes_and_sizes(benchmark::internal::Benchmark* b) {
+        for (int shape : { SQUARE, TALL, WIDE })
+            for (int log2_size = MIN_LOG2_SIZE; log2_size <= MAX_LOG2_SIZE; log2_size += 4)
+                b->Args({ shape, log2_size });
+    }
+
+    void shapes_sizes_and_flips(benchmark::internal::Benchmark* b) {
+        // third arg: bit flips per byte array, i.e. an error rate of flips / (8 * size).
+        for (int shape : { SQUARE, TALL, WIDE })
+            for (int log2_size = MIN_LOG2_SIZE; log2_size <= MAX_LOG2_SIZE; log2_size += 4)
+                for (int flips : { 0, 1, 2, 8 })
+                    b->Args({ shape, log2_size, flips });
+    }
+
+    void set_bytes(benchmark::State& state, std::size_t bytes_per_op) {
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes_per_op));
+        state.SetLabel(shape_label(state));
+    }
+}
+
+static void Construct(benchmark::State& state) {
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    for (auto _ : state) {
+        ParityHdr hdr(s.B, s.N, arr);
+        benchmark::DoNotOptimize(hdr);
+    }
+    set_bytes(state, s.size());
+}
+BENCHMARK(Construct)->Apply(shapes_and_sizes);
+
+static void ConstructThreaded(benchmark::State& state) {
+    // (0 threads: std::thread::hardware_concurrency() of them.)
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    for (auto _ : state) {
+        ParityHdr hdr(s.B, s.N, arr, 0U);
+        benchmark::DoNotOptimize(hdr);
+    }
+    set_bytes(state, s.size());
+}
+BENCHMARK(ConstructThreaded)->Apply(shapes_and_sizes)->UseRealTime();
+
+static void ConstructStreaming(benchmark::State& state) {
+    // ParityHdrBuilder fed 64 KB chunks, as off a socket.
+    constexpr std::size_t CHUNK{ 1 << 16 };
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    ParityChecking::ParityHdrBuilder builder(s.B, s.N);
+    for (auto _ : state) {
+        for (std::size_t k = 0; k < s.size(); k += CHUNK)
+            builder.update(arr + k, std::min(CHUNK, s.size() - k));
+        ParityHdr hdr = builder.finish();
+        benchmark::DoNotOptimize(hdr);
+    }
+    set_bytes(state, s.size());
+}
+BENCHMARK(ConstructStreaming)->Apply(shapes_and_sizes);
+
+static void ConstructRowMajor(benchmark::State& state) {
+    // The same byte array read as a row-major B x N matrix (so it is a different matrix, but
+    // the same work as a column-major one), rather than transposed first.
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    for (auto _ : state) {
+        ParityHdr hdr(s.B, s.N, arr, ParityChecking::Layout::row_major());
+        benchmark::DoNotOptimize(hdr);
+    }
+    set_bytes(state, s.size());
+}
+BENCHMARK(ConstructRowMajor)->Apply(shapes_and_sizes);
+
+static void ConstructIsa(benchmark::State& state) {
+    // A 1 MB square byte array with the kernels forced to Isa range(0) (skipped if unsupported.)
+    auto isa = static_cast<ParityChecking::kernels::Isa>(state.range(0));
+    ParityChecking::kernels::Isa was = ParityChecking::kernels::active_isa();
+    if (!ParityChecking::kernels::set_isa(isa)) {
+        state.SkipWithError("Isa not supported by this cpu");
+        return;
+    }
+    const std::uint32_t B{ 1024 }, N{ 1024 };
+    const unsigned char* arr = byte_array(std::size_t{ B } * N);
+    ParityHdr hdr;
+    for (auto _ : state) {
+        hdr.reset(B, N);
+        hdr.recompute(arr);
+        benchmark::DoNotOptimize(hdr);
+    }
+    ParityChecking::kernels::set_isa(was);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * B * N));
+    state.SetLabel(ParityChecking::kernels::isa_name(isa));
+}
+BENCHMARK(ConstructIsa)->DenseRange(0, static_cast<int>(ParityChecking::kernels::Isa::NEON));
+
+static void Serialize(benchmark::State& state) {
+    Shape s = shape_of(state);
+    ParityHdr hdr(s.B, s.N, byte_array(s.size()));
+    auto integrity = static_cast<ParityChecking::Integrity>(state.range(2));
+    std::vector<unsigned char> buf(hdr.serialized_size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hdr.serialize_into(buf, integrity));
+        benchmark::ClobberMemory();
+    }
+    set_bytes(state, buf.size());
+}
+BENCHMARK(Serialize)->ArgsProduct({ { SQUARE, TALL, WIDE }, { 10, 20, 30 }, { 0, 1 } });
+
+static void LoadFromSerialized(benchmark::State& state) {
+    Shape s = shape_of(state);
+    ParityHdr hdr(s.B, s.N, byte_array(s.size()));
+    auto integrity = static_cast<ParityChecking::Integrity>(state.range(2));
+    std::vector<unsigned char> buf(hdr.serialized_size());
+    hdr.serialize_into(buf, integrity);
+    ParityHdr rcvd_hdr;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(rcvd_hdr.load_from_serialized(buf.data()));
+    set_bytes(state, buf.size());
+}
+BENCHMARK(LoadFromSerialized)->ArgsProduct({ { SQUARE, TALL, WIDE }, { 10, 20, 30 }, { 0, 1 } });
+
+static void Equal(benchmark::State& state) {
+    // operator== of two equal ParityHdrs (so comparing all of them.)
+    Shape s = shape_of(state);
+    ParityHdr lhs(s.B, s.N, byte_array(s.size())), rhs(s.B, s.N, byte_array(s.size()));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(lhs == rhs);
+    set_bytes(state, std::size_t{ s.B } + s.N);
+}
+BENCHMARK(Equal)->ArgsProduct({ { SQUARE, TALL, WIDE }, { 10, 20, 30 } });
+
+static void Verify(benchmark::State& state) {
+    // verify of a received byte array with range(2) bit flips, collecting the mismatches.
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    ParityHdr rcvd_hdr(s.B, s.N, arr);
+    std::vector<unsigned char> t(arr, arr + s.size());
+    std::mt19937_64 gen{ 2 };
+    flip_random_bits(t.data(), t.size(), static_cast<int>(state.range(2)), gen);
+    ParityChecking::ParityMismatch mismatch;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(verify(rcvd_hdr, t.data(), mismatch));
+    set_bytes(state, s.size());
+}
+BENCHMARK(Verify)->Apply(shapes_sizes_and_flips);
+
+static void FindErrorLocations(benchmark::State& state) {
+    // Locating 1 flipped bit from the received ParityHdr and that of the received byte array.
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    ParityHdr rcvd_hdr(s.B, s.N, arr);
+    std::vector<unsigned char> t(arr, arr + s.size());
+    t[t.size() / 3] ^= 0x10;
+    ParityHdr t_hdr(s.B, s.N, t.data());
+    std::size_t i, j;
+    for (auto _ : state) {
+        find_error_locations(rcvd_hdr, t_hdr, &i, &j);
+        benchmark::DoNotOptimize(i);
+        benchmark::DoNotOptimize(j);
+    }
+    set_bytes(state, std::size_t{ s.B } + s.N);
+}
+BENCHMARK(FindErrorLocations)->ArgsProduct({ { SQUARE, TALL, WIDE }, { 10, 20, 30 } });
+
+static void RepairByteArray(benchmark::State& state) {
+    /* The whole receive side for a byte array with range(2) bit flips: t's ParityHdr, then
+       try_repair_byte_array (which fails, without throwing, for most multiple flips.) The flips
+       come from a rotating set drawn up front, and are made and undone inside the timing, as
+       pausing it every iteration costs more than the repair of the smaller sizes. Undoing them
+       is O(flips), plus an O(B + N) try_find_error_locations to undo a successful repair's flip. */
+    Shape s = shape_of(state);
+    const unsigned char* arr = byte_array(s.size());
+    ParityHdr rcvd_hdr(s.B, s.N, arr);
+    std::vector<unsigned char> t(arr, arr + s.size());
+    std::mt19937_64 gen{ 3 };
+    const std::size_t n_flips = static_cast<std::size_t>(state.range(2));
+    constexpr std::size_t N_SETS{ 64 };
+    std::vector<std::size_t> flip_bits(N_SETS * n_flips);  // set k is [k * n_flips, (k + 1) * n_flips).
+    for (std::size_t& bit : flip_bits)
+        bit = gen() % (8 * t.size());
+    auto flip = [&t](std::size_t bit) { t[bit / 8] ^= 0x80 >> bit % 8; };
+    std::int64_t repaired{ 0 };
+    std::size_t set{ 0 };
+    for (auto _ : state) {
+        const std::size_t* bits = flip_bits.data() + set * n_flips;
+        set = (set + 1) % N_SETS;
+        for (std::size_t f = 0; f < n_flips; ++f)
+            flip(bits[f]);
+        ParityHdr t_hdr(s.B, s.N, t.data());
+        if (try_repair_byte_array(rcvd_hdr, t_hdr, t.data()) == ParityChecking::RepairStatus::Ok) {
+            ++repaired;
+            std::size_t i, j;
+            try_find_error_locations(rcvd_hdr, t_hdr, &i, &j);
+            flip(j * s.B * 8 + i);
+        }
+        for (std::size_t f = 0; f < n_flips; ++f)
+            flip(bits[f]);
+    }
+    set_bytes(state, s.size());
+    state.counters["repaired"] = benchmark::Counter(static_cast<double>(repaired), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(RepairByteArray)->Apply(shapes_sizes_and_flips);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,132 @@
+#include "channel_sim.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+namespace ParityChecking::channel {
+
+    namespace {
+        std::uint64_t splitmix64(std::uint64_t& x) {
+            x += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        inline std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        inline std::uint64_t add_gap(std::uint64_t at, std::uint64_t gap) {
+            // at + gap, saturating at NEVER (so NEVER gaps stay past the end of any byte array.)
+            return gap > GeometricGaps::NEVER - at ? GeometricGaps::NEVER : at + gap;
+        }
+
+        inline void flip(unsigned char* buf, std::uint64_t bit) {
+            buf[bit / 8] ^= 0x80 >> bit % 8;
+        }
+
+        std::size_t flip_iid(unsigned char* buf, std::uint64_t begin, std::uint64_t end,
+            const GeometricGaps& flip_gaps, Xoshiro256& rng) {
+            /* Flips each bit in [begin, end) with flip_gaps' probability, returning how many. */
+            std::size_t n_flips = 0;
+            for (std::uint64_t bit = add_gap(begin, flip_gaps.next(rng)); bit < end;
+                bit = add_gap(bit + 1, flip_gaps.next(rng))) {
+                flip(buf, bit);
+                ++n_flips;
+            }
+            return n_flips;
+        }
+    }
+
+    Xoshiro256::Xoshiro256(std::uint64_t seed, std::uint64_t stream) {
+        /* The 4 state words are successive splitmix64 outputs, starting from seed mixed with
+           (a splitmix64 of) stream, which is never all zeros. */
+        std::uint64_t x = stream;
+        x = seed ^ splitmix64(x);
+        for (std::uint64_t& w : s)
+            w = splitmix64(x);
+    }
+
+    Xoshiro256::result_type Xoshiro256::operator()() {
+        const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    double Xoshiro256::uniform() {
+        return static_cast<double>(((*this)() >> 11) + 1) * 0x1p-53;
+    }
+
+    GeometricGaps::GeometricGaps(double p)
+        : never{ p <= 0 }, inv_log_q{ p >= 1 ? -0.0 : 1 / std::log1p(-p) } { }
+
+    std::uint64_t GeometricGaps::next(Xoshiro256& rng) const {
+        /* The number of failures before the first success, floor(log(u) / log(1 - p)). */
+        if (never)
+            return NEVER;
+        double gap = std::log(rng.uniform()) * inv_log_q;
+        return gap < 0x1p63 ? static_cast<std::uint64_t>(gap) : NEVER;
+    }
+
+    IidChannel::IidChannel(double bit_error_rate) : flip_gaps{ bit_error_rate } { }
+
+    std::size_t IidChannel::apply(unsigned char* buf, std::size_t len, Xoshiro256& rng) const {
+        return flip_iid(buf, 0, 8 * std::uint64_t{ len }, flip_gaps, rng);
+    }
+
+    BurstChannel::BurstChannel(double burst_rate, double mean_burst_bits, double flip_prob)
+        : burst_gaps{ burst_rate }, burst_ends{ 1 / std::max(1.0, mean_burst_bits) },
+        flip_gaps{ flip_prob } { }
+
+    std::size_t BurstChannel::apply(unsigned char* buf, std::size_t len, Xoshiro256& rng) const {
+        /* Bursts of 1 + geometric lengths (mean mean_burst_bits), separated by geometric gaps. */
+        const std::uint64_t n_bits = 8 * std::uint64_t{ len };
+        std::size_t n_flips = 0;
+        for (std::uint64_t start = burst_gaps.next(rng); start < n_bits; ) {
+            std::uint64_t end = std::min(n_bits, add_gap(start + 1, burst_ends.next(rng)));
+            n_flips += flip_iid(buf, start, end, flip_gaps, rng);
+            start = add_gap(end, burst_gaps.next(rng));
+        }
+        return n_flips;
+    }
+
+    GilbertElliottChannel::GilbertElliottChannel(double p_good_to_bad, double p_bad_to_good,
+        double ber_good, double ber_bad)
+        : p_start_bad{ p_good_to_bad + p_bad_to_good > 0
+            ? p_good_to_bad / (p_good_to_bad + p_bad_to_good) : 0 },
+        stays{ GeometricGaps{ p_good_to_bad }, GeometricGaps{ p_bad_to_good } },
+        flip_gaps{ GeometricGaps{ ber_good }, GeometricGaps{ ber_bad } } { }
+
+    std::size_t GilbertElliottChannel::apply(unsigned char* buf, std::size_t len, Xoshiro256& rng) const {
+        /* Alternating stays in the good and bad states, each 1 + geometric (with the state's
+           chance of leaving at each bit) long, flipping IID at that state's rate during them. */
+        const std::uint64_t n_bits = 8 * std::uint64_t{ len };
+        std::size_t n_flips = 0;
+        int bad = rng.uniform() <= p_start_bad ? 1 : 0;
+        for (std::uint64_t start = 0; start < n_bits; bad ^= 1) {
+            std::uint64_t end = std::min(n_bits, add_gap(start + 1, stays[bad].next(rng)));
+            n_flips += flip_iid(buf, start, end, flip_gaps[bad], rng);
+            start = end;
+        }
+        return n_flips;
+    }
+
+    void run_trials(std::uint64_t n_trials, std::uint64_t seed, const Trial& trial,
+        const Executor& executor, unsigned n_tasks) {
+        n_tasks = static_cast<unsigned>(std::clamp<std::uint64_t>(n_trials, 1, std::max(1U, n_tasks)));
+        const std::uint64_t per_task = (n_trials + n_tasks - 1) / n_tasks;
+        executor(n_tasks, [&](unsigned task) {
+            const std::uint64_t last = std::min(n_trials, (task + 1) * per_task);
+            for (std::uint64_t k = task * per_task; k < last; ++k) {
+                Xoshiro256 rng{ seed, k };
+                trial(k, rng, task);
+            }
+        });
+    }
+}
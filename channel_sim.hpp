@@ -0,0 +1,99 @@
+#ifndef CHANNEL_SIM_HDR
+#define CHANNEL_SIM_HDR
+
+/*
+Noise channel simulation for soak testing ParityChecking configurations: channel models that
+flip bits of a transmitted byte array in place, a fast seedable PRNG to drive them, and a runner
+spreading many independent trials across cores.
+  IidChannel            - every bit flips independently with probability bit_error_rate.
+  BurstChannel          - error bursts start independently at each bit, with geometrically
+                          distributed lengths, within which each bit flips with flip_prob.
+  GilbertElliottChannel - a 2 state (good/bad) Markov chain, stepped once per bit, with IID
+                          flips at each state's own bit error rate.
+All draw the gaps between events (flips, burst starts, state changes) from geometric
+distributions, so the cost is proportional to the number of events, not of bits.
+Bits are numbered as in ParityChecking: bit k of the array is bit 0x80 >> k % 8 of byte k / 8.
+*/
+#include "parity_checking.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+namespace ParityChecking::channel {
+
+  // xoshiro256** (Blackman & Vigna): 4 words of state, a few ns per 64 bit output, and a
+  // UniformRandomBitGenerator, so usable with the <random> distributions too.
+  // Seeded by splitmix64, from a seed and a stream number: different streams of the same seed
+  // are independent, and each trial of run_trials gets its' own, so results are reproducible
+  // whatever the number of threads.
+  class Xoshiro256 {
+    public:
+    using result_type = std::uint64_t;
+    explicit Xoshiro256(std::uint64_t seed, std::uint64_t stream = 0);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+    result_type operator()();
+    double uniform();  // in (0, 1].
+
+    private:
+    std::uint64_t s[4];
+  };
+
+  // Draws the gaps (numbers of bits) between successive events that each happen independently
+  // at every bit with probability p: geometrically distributed, from one log of a uniform.
+  class GeometricGaps {
+    public:
+    static constexpr std::uint64_t NEVER{ std::numeric_limits<std::uint64_t>::max() };
+    explicit GeometricGaps(double p);
+    std::uint64_t next(Xoshiro256& rng) const;  // NEVER when p == 0.
+
+    private:
+    bool never;        // p == 0.
+    double inv_log_q;  // 1 / log(1 - p) (-0 when p == 1, so every gap is 0.)
+  };
+
+  class IidChannel {
+    public:
+    explicit IidChannel(double bit_error_rate);
+    // Flips the bits of the len byte buf, returning the number flipped:
+    std::size_t apply(unsigned char* buf, std::size_t len, Xoshiro256& rng) const;
+
+    private:
+    GeometricGaps flip_gaps;
+  };
+
+  class BurstChannel {
+    public:
+    BurstChannel(double burst_rate, double mean_burst_bits, double flip_prob = 0.5);
+    std::size_t apply(unsigned char* buf, std::size_t len, Xoshiro256& rng) const;
+
+    private:
+    GeometricGaps burst_gaps;    // between bursts,
+    GeometricGaps burst_ends;    // the burst lengths (- 1),
+    GeometricGaps flip_gaps;     // and between flips within a burst.
+  };
+
+  // Each apply (byte array) starts in a state drawn from the chain's stationary distribution, so
+  // byte arrays are independent, and the (const) channel can be shared across threads.
+  class GilbertElliottChannel {
+    public:
+    GilbertElliottChannel(double p_good_to_bad, double p_bad_to_good, double ber_good, double ber_bad);
+    std::size_t apply(unsigned char* buf, std::size_t len, Xoshiro256& rng) const;
+
+    private:
+    double p_start_bad;
+    GeometricGaps stays[2];      // [0] good, [1] bad: the lengths (- 1) of each stay in a state,
+    GeometricGaps flip_gaps[2];  // and the gaps between flips during it.
+  };
+
+  // Runs trial(k, rng, task) for each k in [0, n_trials), with rng == Xoshiro256(seed, k), split
+  // into contiguous runs of trials among n_tasks tasks of executor (task in [0, n_tasks) being
+  // which, e.g. to index per task results or buffers.)
+  using Trial = std::function<void(std::uint64_t k, Xoshiro256& rng, unsigned task)>;
+  void run_trials(std::uint64_t n_trials, std::uint64_t seed, const Trial& trial,
+    const Executor& executor, unsigned n_tasks);
+}
+
+#endif
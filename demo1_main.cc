@@ -1,4 +1,5 @@
 #include "parity_checking.hpp"
+#include "channel_sim.hpp"
 #include <iostream>
 #include <iomanip>
 #include <cstring>
@@ -8,7 +9,9 @@
 using std::cout, std::endl, std::hex;
 
 using ParityChecking::ParityHdr;           // class to store byte arrays' parity information.
-using ParityChecking::repair_byte_array;   // function to repair byte error transmission errors.
+using ParityChecking::correct_byte_array;  // function to repair byte array transmission errors.
+using ParityChecking::verify;              // function to check a byte array against a ParityHdr.
+using ParityChecking::damaged_regions;     // function giving the parts of a byte array to re-send.
 
 unsigned char* transmit(const unsigned char*, size_t); // mimics transmission of byte array.
 static double ERROR_RATE{ 0 };   // probability of any 1 bit flipping during transmition. Try 1./len_s.
@@ -49,8 +52,8 @@ int main() {
     // Construct its ParityHdr, s_hdr:
     ParityHdr s_hdr(B, N, s);
 
-    // Serialize s_hdr for transmission:
-    const unsigned char* s_hdr_ser = s_hdr.serialize();
+    // Serialize s_hdr for transmission, protected by a CRC-32C (rather than the weaker sums):
+    const unsigned char* s_hdr_ser = s_hdr.serialize(ParityChecking::Integrity::CRC32C);
 
     // Construct a ParityHdr to receive this:
     ParityHdr rcvd_hdr;
@@ -61,7 +64,7 @@ int main() {
     int MAX_HDR_TRYS{ 30 };
     while (n_transmits < MAX_HDR_TRYS) {
         //cout << "Transmitting ParityHdr, attempt #" << n_transmits << endl;
-        size_t n_bytes = 3 * sizeof(unsigned int) + 4 * sizeof(short) + B + N;
+        size_t n_bytes = s_hdr.serialized_size();
         const unsigned char* rcvd_hdr_ser = transmit(s_hdr_ser, n_bytes);
         check_sum_match = rcvd_hdr.load_from_serialized(rcvd_hdr_ser);
         delete[] rcvd_hdr_ser;
@@ -79,37 +82,45 @@ int main() {
 
     // At this point we have a check_sum confirmed good receipt of s_hdr as rcvd_hdr.
     // Now transmit byte array s to t. rcvd_hdr will be used to check t for errors
-    // and to correct up to 1 bit error in t:
+    // and to correct up to 1 bit error in t (else re-sending just the damaged parts of t):
     int MAX_TRYS = 30;
     int n_trys{ 0 };
     unsigned char* t{ nullptr };
+    // Where each received t's parities differ from rcvd_hdr's, reused across retransmissions:
+    ParityChecking::ParityMismatch mismatch;
     while (n_trys < MAX_TRYS) {
-        // Transmit s to the receivers' byte array t:
+        // Transmit s to the receivers' byte array t (after the first time, just its damaged parts):
         n_trys += 1;
-        t = transmit(s, B * N);
-        // and construct its' ParityHdr: (Note we use rcvd_hdr to get dimensions B and N) 
-        ParityHdr t_hdr(rcvd_hdr.getB(), rcvd_hdr.getN(), t);
+        if (!t)
+            t = transmit(s, B * N);
 
-        // Compare this t_hdr with the already received and check_sum confirmed ParityHdr, rcvd_hdr:
-        if (t_hdr == rcvd_hdr) {
+        // Check t against the already received and check_sum confirmed ParityHdr, rcvd_hdr,
+        // (verify doesn't build t's ParityHdr, just collects any parity mismatches):
+        if (verify(rcvd_hdr, t, mismatch)) {
             cout << "ParityHdrs match, No parity detectable errors during transmision\n";
             cout << "Received byte array: \n";
-            for (int i = 0; i < std::min(t_hdr.getB() * t_hdr.getN(), 100U); ++i)
+            for (int i = 0; i < std::min(rcvd_hdr.getB() * rcvd_hdr.getN(), 100U); ++i)
                 cout << hex << static_cast<int>(t[i]) << ((i + 1) % 32 ? ' ' : '\n');
             cout << "..." << endl;
         }
-        else {  // Use ParityHdrs to repair t:
-            try {
-                repair_byte_array(rcvd_hdr, t_hdr, t);
-            }
-            catch (ParityChecking::PC_Exception& e) {
-                cout << "Error in repair_byte_array:\n";
-                cout << e.what() << "-Retransmitting...\n" << endl;
-                delete[] t;
+        else {  // Use the mismatches to repair t:
+            ParityChecking::Correction correction = correct_byte_array(rcvd_hdr, mismatch, t);
+            if (correction.status != ParityChecking::Correction::Status::Corrected) {
+                cout << "correct_byte_array couldn't repair t ("
+                     << (correction.status == ParityChecking::Correction::Status::Ambiguous
+                         ? "ambiguous" : "uncorrectable")
+                     << " errors), -Retransmitting the damaged regions:";
+                for (const ParityChecking::ByteRange& region : damaged_regions(rcvd_hdr, mismatch)) {
+                    cout << std::dec << " [" << region.offset << ", " << region.offset + region.length << ")";
+                    unsigned char* resent = transmit(s + region.offset, region.length);
+                    std::memcpy(t + region.offset, resent, region.length);
+                    delete[] resent;
+                }
+                cout << "\n" << endl;
                 continue;
             }
-            cout << "Repaired the received byte array to give:\n";
-            for (int i = 0; i < std::min(t_hdr.getB() * t_hdr.getN(), 100U); ++i)
+            cout << "Repaired " << correction.flipped.size() << " bit(s) of the received byte array to give:\n";
+            for (int i = 0; i < std::min(rcvd_hdr.getB() * rcvd_hdr.getN(), 100U); ++i)
                 cout << hex << static_cast<int>(t[i]) << ((i + 1) % 32 ? ' ' : '\n');
             cout << "..." << endl;
         }
@@ -147,31 +158,19 @@ unsigned char* transmit(const unsigned char* cs, size_t len) {
        len == B*N is length of byte array in bytes(== 8*len bits).
        ERROR_RATE is the IID probability that any one transmitted bit is flipped.
        It is assumed any bit is flipped with this same probability, independent of
-       any other bit flips.
+       any other bit flips. (channel_sim.hpp also has burst and Gilbert-Elliott channels.)
        pointer, s, to new memory containing the received byte array is returned. */
 
     unsigned char* s = new unsigned char[len];
     std::memcpy(s, cs, len);
 
-    if (ERROR_RATE < 1.e-9 / len) // neglect transmission errors (geom{0} returns garbage.)
-        return s;
-
-    // long unsigned int seed = 1;    // Replace next 2 lines with these 2 for reproducing random 
-    // static std::mt19937 gen{seed}; // bit streams for testing.
-    std::random_device rd;
-    static std::mt19937 gen{ rd() };
+    // long unsigned int seed = 1;    // Replace next line with these 2 for reproducing random 
+    // static ParityChecking::channel::Xoshiro256 gen{ seed }; // bit streams for testing.
+    static ParityChecking::channel::Xoshiro256 gen{ std::random_device{}() };
 
-    // idx increment to next flipped bit is geometrically distributed with probability of bit 
-    // flip == ERROR_RATE:
-    std::geometric_distribution<> geom{ ERROR_RATE };
-
-    int idx{ 0 };                 // Starting at beginning of byte array,
-    while (idx < 8 * len) {
-        idx += geom(gen);         // random number of steps to next flip
-        if (idx < 8 * len)        // if that lies within array being transmitted
-            s[idx / 8] ^= 0x80 >> idx % 8;  // flip it.
-    }
+    // The channel flips each bit of s in place with probability ERROR_RATE (skipping
+    // geometrically distributed numbers of bits between flips):
+    ParityChecking::channel::IidChannel{ ERROR_RATE }.apply(s, len, gen);
 
     return s;
 }
-
@@ -0,0 +1,177 @@
+#include "parity_checking.hpp"
+#include "channel_sim.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+/*
+Monte Carlo estimate of the end to end cost of delivering payloads over a noisy (IID) channel with
+the demo1_main.cc protocol, over a grid of (B, N, ERROR_RATE, payload size):
+  the payload is cut into B x N frames (the last zero padded), and for each frame
+  - its' ParityHdr is calculated, serialized (with a CRC-32C) and sent until received intact,
+    up to MAX_HDR_TRYS times,
+  - the frame is sent, then verified against the received ParityHdr and repaired with
+    correct_byte_array; when it can't be, just its' damaged_regions are re-sent, up to MAX_TRYS
+    times in all.
+Reported per grid point, over all the trials (payloads):
+  delivered   - % of payloads delivered intact (the rest ran out of tries, or were wrong),
+  residual    - payloads accepted (verified or repaired) yet differing from what was sent,
+  retx mean/p99 - re-sends (ParityHdrs or regions) per payload,
+  goodput     - payload bytes delivered / all bytes sent, ParityHdrs and re-sends included,
+  cpu ns/B    - cpu time (all threads) per payload byte delivered.
+Usage: montecarlo [trials per grid point (default 200)] [threads (default all)]
+  g++ -std=c++20 -O2 -pthread montecarlo_main.cc parity_checking.cc parity_kernels.cc channel_sim.cc -o montecarlo
+*/
+
+using ParityChecking::ParityHdr;
+using ParityChecking::ParityHdrView;
+using ParityChecking::channel::IidChannel;
+using ParityChecking::channel::Xoshiro256;
+
+namespace {
+    constexpr int MAX_HDR_TRYS{ 30 };
+    constexpr int MAX_TRYS{ 30 };
+
+    struct Config {
+        std::uint32_t B;
+        std::uint32_t N;
+        double error_rate;
+        std::size_t payload;
+    };
+
+    struct TrialResult {
+        std::uint32_t resends{ 0 };
+        std::uint64_t bytes_sent{ 0 };
+        bool delivered{ false };
+        bool residual{ false };  // accepted, but wrong.
+    };
+
+    struct TaskState {
+        // Reused by each of a task's trials, so trials don't allocate.
+        ParityHdr s_hdr;
+        std::vector<unsigned char> ser, rcvd_ser, t;
+        ParityChecking::ParityMismatch mismatch;
+    };
+
+    bool deliver_frame(const Config& c, const unsigned char* s, TaskState& ts, const IidChannel& channel,
+        Xoshiro256& rng, TrialResult& r) {
+        /* Sends one B x N frame, s, and its' ParityHdr: true if it was accepted (maybe wrongly.) */
+        const std::size_t frame = std::size_t{ c.B } * c.N;
+        ts.s_hdr.reset(c.B, c.N);
+        ts.s_hdr.recompute(s);
+        std::size_t ser_len = ts.s_hdr.serialize_into(ts.ser, ParityChecking::Integrity::CRC32C);
+
+        ParityHdrView rcvd_hdr;
+        int n_transmits = 0;
+        for (;;) {
+            std::memcpy(ts.rcvd_ser.data(), ts.ser.data(), ser_len);
+            channel.apply(ts.rcvd_ser.data(), ser_len, rng);
+            r.bytes_sent += ser_len;
+            if (rcvd_hdr.load_from_serialized(ts.rcvd_ser.data()))
+                break;
+            if (++n_transmits >= MAX_HDR_TRYS)
+                return false;
+            ++r.resends;
+        }
+
+        unsigned char* t = ts.t.data();
+        std::memcpy(t, s, frame);
+        channel.apply(t, frame, rng);
+        r.bytes_sent += frame;
+        for (int n_trys = 1; ; ++n_trys) {
+            if (verify(rcvd_hdr, t, ts.mismatch))
+                break;
+            auto correction = correct_byte_array(rcvd_hdr, ts.mismatch, t);
+            if (correction.status == ParityChecking::Correction::Status::Corrected)
+                break;
+            if (n_trys >= MAX_TRYS)
+                return false;
+            for (const ParityChecking::ByteRange& region : damaged_regions(rcvd_hdr, ts.mismatch)) {
+                std::memcpy(t + region.offset, s + region.offset, region.length);
+                channel.apply(t + region.offset, region.length, rng);
+                r.bytes_sent += region.length;
+            }
+            ++r.resends;
+        }
+        if (std::memcmp(t, s, frame) != 0)
+            r.residual = true;
+        return true;
+    }
+
+    void run_config(const Config& c, std::uint64_t n_trials, unsigned n_threads) {
+        const std::size_t frame = std::size_t{ c.B } * c.N;
+        const std::size_t n_frames = (c.payload + frame - 1) / frame;
+        std::vector<unsigned char> payload(n_frames * frame, 0);  // (zero padded to whole frames.)
+        Xoshiro256 fill{ 12345 };
+        for (std::size_t k = 0; k < c.payload; ++k)
+            payload[k] = static_cast<unsigned char>(fill());
+
+        const IidChannel channel{ c.error_rate };
+        std::vector<TaskState> tasks(n_threads);
+        for (TaskState& ts : tasks) {
+            ts.ser.resize(ParityChecking::SERIALIZED_FIELDS_SIZE + c.B + c.N);
+            ts.rcvd_ser.resize(ts.ser.size());
+            ts.t.resize(frame);
+        }
+        std::vector<TrialResult> results(n_trials);
+
+        std::clock_t cpu_start = std::clock();
+        ParityChecking::channel::run_trials(n_trials, /*seed*/ 1,
+            [&](std::uint64_t k, Xoshiro256& rng, unsigned task) {
+                TrialResult& r = results[k];
+                r.delivered = true;
+                for (std::size_t f = 0; f < n_frames && r.delivered; ++f)
+                    r.delivered = deliver_frame(c, payload.data() + f * frame, tasks[task], channel, rng, r);
+                r.delivered = r.delivered && !r.residual;
+            },
+            ParityChecking::thread_executor(), n_threads);
+        double cpu_ns = 1e9 * static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+        std::uint64_t delivered = 0, residual = 0, bytes_sent = 0;
+        double resends = 0;
+        std::vector<std::uint32_t> resend_counts;
+        resend_counts.reserve(n_trials);
+        for (const TrialResult& r : results) {
+            delivered += r.delivered;
+            residual += r.residual;
+            bytes_sent += r.bytes_sent;
+            resends += r.resends;
+            resend_counts.push_back(r.resends);
+        }
+        std::size_t p99_at = static_cast<std::size_t>(0.99 * static_cast<double>(n_trials - 1));
+        std::nth_element(resend_counts.begin(), resend_counts.begin() + p99_at, resend_counts.end());
+        double delivered_bytes = static_cast<double>(delivered) * static_cast<double>(c.payload);
+
+        std::printf("%6u %6u %8.1e %9zu %9.2f%% %8llu %9.3f %6u %9.4f %9.3f\n", c.B, c.N, c.error_rate,
+            c.payload, 100.0 * static_cast<double>(delivered) / static_cast<double>(n_trials),
+            static_cast<unsigned long long>(residual), resends / static_cast<double>(n_trials),
+            resend_counts[p99_at], delivered_bytes / static_cast<double>(bytes_sent),
+            delivered_bytes > 0 ? cpu_ns / delivered_bytes : 0.0);
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t n_trials = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+    unsigned n_threads = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 0;
+    if (n_threads == 0)
+        n_threads = std::max(1U, std::thread::hardware_concurrency());
+    if (n_trials == 0)
+        return 0;
+
+    const std::uint32_t shapes[][2]{ { 64, 64 }, { 128, 128 }, { 256, 256 }, { 1024, 64 }, { 64, 1024 } };
+    const double error_rates[]{ 1e-6, 1e-5, 1e-4 };
+    const std::size_t payloads[]{ 4 << 10, 64 << 10, 1 << 20 };
+
+    std::printf("%6s %6s %8s %9s %10s %8s %9s %6s %9s %9s\n", "B", "N", "rate", "payload",
+        "delivered", "residual", "retx mean", "p99", "goodput", "cpu ns/B");
+    for (const auto& shape : shapes)
+        for (double error_rate : error_rates)
+            for (std::size_t payload : payloads)
+                run_config({ shape[0], shape[1], error_rate, payload }, n_trials, n_threads);
+    return 0;
+}
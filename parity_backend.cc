@@ -0,0 +1,105 @@
+#include "parity_backend.hpp"
+#include "parity_kernels.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+
+namespace ParityChecking::backend {
+
+    namespace {
+        constexpr std::size_t CACHE_LINE{ 64 };
+
+        template <typename F>
+        void split(const Executor& executor, unsigned n_tasks, std::size_t count, F run) {
+            /* run(first, last, task) for contiguous runs of the count tiles, one per task. */
+            n_tasks = static_cast<unsigned>(std::min<std::size_t>(n_tasks, count));
+            if (n_tasks <= 1) {
+                run(0, count, 0);
+                return;
+            }
+            std::size_t per_task = (count + n_tasks - 1) / n_tasks;
+            executor(n_tasks, [&](unsigned t) {
+                run(std::min(count, t * per_task), std::min(count, (t + 1) * per_task), t);
+            });
+        }
+
+        void tile_parities(std::uint32_t B, std::uint32_t N, const unsigned char* tile, unsigned char* rows) {
+            std::memset(rows, 0, B);
+            kernels::accumulate_cols(tile, B, N, rows, rows + B);
+        }
+    }
+
+    CpuBackend::CpuBackend(Executor executor, unsigned n_tasks)
+        : executor{ std::move(executor) }, n_tasks{ n_tasks ? n_tasks : 1 } { }
+
+    unsigned char* CpuBackend::allocate(std::size_t len) {
+        void* p = std::aligned_alloc(CACHE_LINE, (len + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+        if (!p && len)
+            throw PC_Exception{ "In CpuBackend::allocate, out of memory.\n" };
+        return static_cast<unsigned char*>(p);
+    }
+
+    void CpuBackend::deallocate(unsigned char* p) noexcept {
+        std::free(p);
+    }
+
+    void CpuBackend::upload(unsigned char* dst, const unsigned char* src, std::size_t len) {
+        std::memcpy(dst, src, len);
+    }
+
+    void CpuBackend::compute(std::uint32_t B, std::uint32_t N, const unsigned char* tiles,
+        std::size_t stride, std::size_t count, unsigned char* parities) {
+        split(executor, n_tasks, count, [&](std::size_t first, std::size_t last, unsigned) {
+            for (std::size_t k = first; k < last; ++k)
+                tile_parities(B, N, tiles + k * stride, parities + k * (std::size_t{ B } + N));
+        });
+    }
+
+    bool CpuBackend::verify(std::uint32_t B, std::uint32_t N, const unsigned char* tiles,
+        std::size_t stride, std::size_t count, const unsigned char* rcvd, std::vector<TileReport>& bad) {
+        /* Each task collects its' run's reports, which are then concatenated in task (so tile)
+           order. A bad tile's mismatches are collected as verify would, then located. */
+        const std::size_t hdr_len = std::size_t{ B } + N;
+        std::vector<std::vector<TileReport>> reports(std::min<std::size_t>(n_tasks, count));
+        split(executor, n_tasks, count, [&](std::size_t first, std::size_t last, unsigned t) {
+            std::vector<unsigned char> parities(hdr_len);
+            ParityMismatch mismatch;
+            for (std::size_t k = first; k < last; ++k) {
+                const unsigned char* rcvd_rows = rcvd + k * hdr_len;
+                tile_parities(B, N, tiles + k * stride, parities.data());
+                if (std::memcmp(parities.data(), rcvd_rows, hdr_len) == 0)
+                    continue;
+                mismatch.clear();
+                kernels::find_mismatches(parities.data() + B, rcvd_rows + B, N, 0, mismatch.cols);
+                kernels::find_mismatches(rcvd_rows, parities.data(), B, 0, mismatch.rows);
+                for (std::size_t row : mismatch.rows)
+                    mismatch.row_flips.push_back(rcvd_rows[row] ^ parities[row]);
+                TileReport report{ k, RepairStatus::Ok, 0, 0 };
+                report.status = try_find_error_locations(mismatch, &report.i, &report.j);
+                reports[t].push_back(report);
+            }
+        });
+        bad.clear();
+        for (const std::vector<TileReport>& run : reports)
+            bad.insert(bad.end(), run.begin(), run.end());
+        return bad.empty();
+    }
+
+    Backend& cpu_backend() {
+        static CpuBackend backend;
+        return backend;
+    }
+
+#if !defined(PARITY_CHECKING_CUDA)
+    Backend* cuda_backend() { return nullptr; }  // (parity_backend_cuda.cu not built in.)
+#endif
+
+    Backend* find_backend(std::string_view name) {
+        if (name == "cpu")
+            return &cpu_backend();
+        if (name == "cuda")
+            return cuda_backend();
+        return nullptr;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef PARITY_BACKEND_HDR
+#define PARITY_BACKEND_HDR
+
+/*
+Backends for bulk parity work on batches of same shape B x N tiles: calculating their parities,
+or verifying them against received parities and locating the bad bit of each bad tile, where
+the tiles live. The cpu backend runs the SIMD kernels on tiles in host memory; the cuda backend
+(parity_backend_cuda.cu, built with -DPARITY_CHECKING_CUDA) runs on tiles already in device
+memory, copying back only the parities calculated, or just the reports of the bad tiles, so a
+scrub isn't bound by host memory bandwidth.
+ParityHdrBatch::compute, TiledParityHdr::compute and verify take a Backend&, chosen at runtime
+by name with find_backend. Tiles are passed in the backend's memory, which allocate/upload give
+backend independent code access to; parities and reports are always in host memory.
+  nvcc -std=c++20 -O2 -DPARITY_CHECKING_CUDA -c parity_backend_cuda.cu
+  g++ -std=c++20 -O2 -DPARITY_CHECKING_CUDA ... parity_backend.cc parity_backend_cuda.o -lcudart
+*/
+#include "parity_checking.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ParityChecking::backend {
+
+  // A bad tile, as verify reports it: status is Ok when its' single bad bit was located at bit
+  // row i of col j (as find_error_locations would), else the cause it couldn't be, NoBadCol to
+  // SeveralBadBits (as try_find_error_locations would return.)
+  struct TileReport {
+    std::size_t tile;
+    RepairStatus status;
+    std::size_t i;
+    std::size_t j;
+  };
+
+  class Backend {
+    public:
+    virtual ~Backend() = default;
+    virtual const char* name() const = 0;
+
+    // Memory in the backend's address space for tiles (throws PC_Exception if it can't be had),
+    // and copies from host memory into it:
+    virtual unsigned char* allocate(std::size_t len) = 0;
+    virtual void deallocate(unsigned char* p) noexcept = 0;
+    virtual void upload(unsigned char* dst, const unsigned char* src, std::size_t len) = 0;
+
+    // The parities of the count B x N tiles at tiles, tiles + stride, ... (backend memory) into
+    // parities (host memory), count * (B + N) bytes: each tile's B row_parities, then its' N
+    // col_parities, as a ParityHdrBatch holds them.
+    virtual void compute(std::uint32_t B, std::uint32_t N, const unsigned char* tiles,
+      std::size_t stride, std::size_t count, unsigned char* parities) = 0;
+    // The tiles' parities compared with the rcvd parities (host memory, laid out as above), the
+    // bad tiles reported into bad, in increasing tile order. True if there are none.
+    virtual bool verify(std::uint32_t B, std::uint32_t N, const unsigned char* tiles,
+      std::size_t stride, std::size_t count, const unsigned char* rcvd,
+      std::vector<TileReport>& bad) = 0;
+  };
+
+  // Runs the kernels on host memory tiles, split among n_tasks tasks of executor.
+  class CpuBackend : public Backend {
+    public:
+    explicit CpuBackend(Executor executor = thread_executor(), unsigned n_tasks = 1);
+    const char* name() const override { return "cpu"; }
+    unsigned char* allocate(std::size_t len) override;
+    void deallocate(unsigned char* p) noexcept override;
+    void upload(unsigned char* dst, const unsigned char* src, std::size_t len) override;
+    void compute(std::uint32_t B, std::uint32_t N, const unsigned char* tiles, std::size_t stride,
+      std::size_t count, unsigned char* parities) override;
+    bool verify(std::uint32_t B, std::uint32_t N, const unsigned char* tiles, std::size_t stride,
+      std::size_t count, const unsigned char* rcvd, std::vector<TileReport>& bad) override;
+
+    private:
+    Executor executor;
+    unsigned n_tasks;
+  };
+
+  Backend& cpu_backend();  // a single task CpuBackend.
+  // The CUDA backend on the current device, or nullptr if not built with PARITY_CHECKING_CUDA
+  // or there is no device. One thread at a time may use it.
+  Backend* cuda_backend();
+  // "cpu" or "cuda", nullptr if that backend isn't available:
+  Backend* find_backend(std::string_view name);
+}
+
+#endif
@@ -0,0 +1,226 @@
+#include "parity_backend.hpp"
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <string>
+
+/*
+The cuda Backend: tiles in device memory, one thread block per tile (grid striding over the
+batch), with only the parities calculated, or the bad tiles' summaries, copied back.
+  nvcc -std=c++20 -O2 -DPARITY_CHECKING_CUDA -c parity_backend_cuda.cu
+and link it with parity_backend.cc (also built with -DPARITY_CHECKING_CUDA) and -lcudart.
+*/
+
+namespace ParityChecking::backend {
+
+    namespace {
+        constexpr unsigned THREADS{ 256 };      // per block, a whole number of warps.
+        constexpr std::size_t MAX_BLOCKS{ 4096 };
+
+        void check(cudaError_t err, const char* what) {
+            if (err != cudaSuccess)
+                throw PC_Exception{ (std::string{ "In CudaBackend, " } + what + ": " +
+                    cudaGetErrorString(err) + "\n").c_str() };
+        }
+
+        __device__ void tile_parities(std::uint32_t B, std::uint32_t N, const unsigned char* tile,
+            unsigned char* rows, unsigned char* cols) {
+            /* Row parities: thread t XORs byte rows t, t + blockDim.x, ... across all N cols, so
+               each warp reads 32 consecutive bytes of a col at a time (coalesced.) Col parities:
+               warp w folds cols w, w + warps, ..., its' lanes reading 32 consecutive bytes at a
+               time, XOR reduced across the warp with shuffles. */
+            for (std::uint32_t i = threadIdx.x; i < B; i += blockDim.x) {
+                unsigned char acc = 0;
+                for (std::uint32_t j = 0; j < N; ++j)
+                    acc ^= tile[std::size_t{ j } * B + i];
+                rows[i] = acc;
+            }
+            const unsigned lane = threadIdx.x % 32, warp = threadIdx.x / 32, n_warps = blockDim.x / 32;
+            for (std::uint32_t j = warp; j < N; j += n_warps) {
+                const unsigned char* col = tile + std::size_t{ j } * B;
+                unsigned fold = 0;
+                for (std::uint32_t i = lane; i < B; i += 32)
+                    fold ^= col[i];
+                for (int offset = 16; offset > 0; offset /= 2)
+                    fold ^= __shfl_xor_sync(0xffffffffU, fold, offset);
+                if (lane == 0)
+                    cols[j] = static_cast<unsigned char>(__popc(fold) & 1);
+            }
+        }
+
+        __global__ void compute_tiles(std::uint32_t B, std::uint32_t N, const unsigned char* tiles,
+            std::size_t stride, std::size_t count, unsigned char* parities) {
+            const std::size_t hdr_len = std::size_t{ B } + N;
+            for (std::size_t k = blockIdx.x; k < count; k += gridDim.x) {
+                unsigned char* rows = parities + k * hdr_len;
+                tile_parities(B, N, tiles + k * stride, rows, rows + B);
+            }
+        }
+
+        // A bad tile's mismatches, as far as locating its' bad bit needs them: how many bad cols
+        // and byte rows (up to 2), the first of each, and that row's parity XOR.
+        struct Summary {
+            unsigned long long tile;
+            unsigned n_cols;
+            unsigned col;
+            unsigned n_rows;
+            unsigned row;
+            unsigned flips;
+        };
+
+        __global__ void verify_tiles(std::uint32_t B, std::uint32_t N, const unsigned char* tiles,
+            std::size_t stride, std::size_t count, const unsigned char* rcvd, unsigned char* scratch,
+            Summary* summaries, unsigned* n_bad) {
+            /* Each block calculates a tile's parities into its' own scratch, then compares them
+               with the received ones, and only a bad tile's block writes a Summary. */
+            __shared__ unsigned n_cols, col, n_rows, row;
+            const std::size_t hdr_len = std::size_t{ B } + N;
+            unsigned char* rows = scratch + blockIdx.x * hdr_len;
+            unsigned char* cols = rows + B;
+            for (std::size_t k = blockIdx.x; k < count; k += gridDim.x) {
+                if (threadIdx.x == 0) {
+                    n_cols = n_rows = 0;
+                    col = row = 0xffffffffU;
+                }
+                tile_parities(B, N, tiles + k * stride, rows, cols);
+                __syncthreads();
+                const unsigned char* rcvd_rows = rcvd + k * hdr_len;
+                const unsigned char* rcvd_cols = rcvd_rows + B;
+                for (std::uint32_t j = threadIdx.x; j < N; j += blockDim.x)
+                    if (cols[j] != rcvd_cols[j]) {
+                        atomicAdd(&n_cols, 1U);
+                        atomicMin(&col, j);
+                    }
+                for (std::uint32_t i = threadIdx.x; i < B; i += blockDim.x)
+                    if (rows[i] != rcvd_rows[i]) {
+                        atomicAdd(&n_rows, 1U);
+                        atomicMin(&row, i);
+                    }
+                __syncthreads();
+                if (threadIdx.x == 0 && (n_cols || n_rows)) {
+                    unsigned at = atomicAdd(n_bad, 1U);
+                    summaries[at] = { k, min(n_cols, 2U), col, min(n_rows, 2U), row,
+                        n_rows ? static_cast<unsigned>(rows[row] ^ rcvd_rows[row]) : 0U };
+                }
+                __syncthreads();  // (before the shared counts and scratch are reused.)
+            }
+        }
+
+        class CudaBackend : public Backend {
+            public:
+            CudaBackend() { check(cudaMalloc(&n_bad, sizeof(unsigned)), "cudaMalloc"); }
+            ~CudaBackend() override {
+                cudaFree(parities);
+                cudaFree(rcvd);
+                cudaFree(scratch);
+                cudaFree(summaries);
+                cudaFree(n_bad);
+            }
+            CudaBackend(const CudaBackend&) = delete;
+            CudaBackend& operator= (const CudaBackend&) = delete;
+
+            const char* name() const override { return "cuda"; }
+
+            unsigned char* allocate(std::size_t len) override {
+                void* p = nullptr;
+                check(cudaMalloc(&p, len), "cudaMalloc");
+                return static_cast<unsigned char*>(p);
+            }
+
+            void deallocate(unsigned char* p) noexcept override {
+                cudaFree(p);
+            }
+
+            void upload(unsigned char* dst, const unsigned char* src, std::size_t len) override {
+                check(cudaMemcpy(dst, src, len, cudaMemcpyHostToDevice), "cudaMemcpy");
+            }
+
+            void compute(std::uint32_t B, std::uint32_t N, const unsigned char* tiles, std::size_t stride,
+                std::size_t count, unsigned char* host_parities) override {
+                if (count == 0)
+                    return;
+                const std::size_t len = count * (std::size_t{ B } + N);
+                grow(parities, parities_len, len);
+                compute_tiles<<<blocks(count), THREADS>>>(B, N, tiles, stride, count, parities);
+                check(cudaGetLastError(), "compute_tiles");
+                check(cudaMemcpy(host_parities, parities, len, cudaMemcpyDeviceToHost), "cudaMemcpy");
+            }
+
+            bool verify(std::uint32_t B, std::uint32_t N, const unsigned char* tiles, std::size_t stride,
+                std::size_t count, const unsigned char* host_rcvd, std::vector<TileReport>& bad) override {
+                /* The received parities go up, and just the bad tiles' Summaries come back, to be
+                   located here by try_find_error_locations (which only looks at the mismatch
+                   counts and the first of each), then put in tile order. */
+                bad.clear();
+                if (count == 0)
+                    return true;
+                const std::size_t hdr_len = std::size_t{ B } + N;
+                const unsigned n_blocks = blocks(count);
+                grow(rcvd, rcvd_len, count * hdr_len);
+                grow(scratch, scratch_len, n_blocks * hdr_len);
+                grow(summaries, summaries_len, count * sizeof(Summary));
+                upload(rcvd, host_rcvd, count * hdr_len);
+                check(cudaMemset(n_bad, 0, sizeof(unsigned)), "cudaMemset");
+                verify_tiles<<<n_blocks, THREADS>>>(B, N, tiles, stride, count, rcvd, scratch,
+                    reinterpret_cast<Summary*>(summaries), n_bad);
+                check(cudaGetLastError(), "verify_tiles");
+                unsigned n = 0;
+                check(cudaMemcpy(&n, n_bad, sizeof n, cudaMemcpyDeviceToHost), "cudaMemcpy");
+                if (n == 0)
+                    return true;
+                std::vector<Summary> found(n);
+                check(cudaMemcpy(found.data(), summaries, n * sizeof(Summary), cudaMemcpyDeviceToHost),
+                    "cudaMemcpy");
+                ParityMismatch mismatch;
+                for (const Summary& s : found) {
+                    mismatch.cols.assign(s.n_cols, s.col);
+                    mismatch.rows.assign(s.n_rows, s.row);
+                    mismatch.row_flips.assign(s.n_rows, static_cast<unsigned char>(s.flips));
+                    TileReport report{ static_cast<std::size_t>(s.tile), RepairStatus::Ok, 0, 0 };
+                    report.status = try_find_error_locations(mismatch, &report.i, &report.j);
+                    bad.push_back(report);
+                }
+                std::sort(bad.begin(), bad.end(),
+                    [](const TileReport& a, const TileReport& b) { return a.tile < b.tile; });
+                return false;
+            }
+
+            private:
+            static unsigned blocks(std::size_t count) {
+                return static_cast<unsigned>(std::min(count, MAX_BLOCKS));
+            }
+
+            void grow(unsigned char*& p, std::size_t& capacity, std::size_t len) {
+                /* The device scratch buffers are reused, only reallocated when they grow. */
+                if (len <= capacity)
+                    return;
+                cudaFree(p);
+                p = nullptr;
+                capacity = 0;
+                check(cudaMalloc(&p, len), "cudaMalloc");
+                capacity = len;
+            }
+
+            unsigned char* parities{ nullptr };
+            std::size_t parities_len{ 0 };
+            unsigned char* rcvd{ nullptr };
+            std::size_t rcvd_len{ 0 };
+            unsigned char* scratch{ nullptr };
+            std::size_t scratch_len{ 0 };
+            unsigned char* summaries{ nullptr };  // (Summary aligned, from cudaMalloc.)
+            std::size_t summaries_len{ 0 };
+            unsigned* n_bad{ nullptr };
+        };
+    }
+
+    Backend* cuda_backend() {
+        /* Created on first use, if there is a device. (Never destroyed: the CUDA runtime may
+           already be torn down during static destruction.) */
+        static CudaBackend* backend = []() -> CudaBackend* {
+            int n_devices = 0;
+            if (cudaGetDeviceCount(&n_devices) != cudaSuccess || n_devices == 0)
+                return nullptr;
+            return new CudaBackend;
+        }();
+        return backend;
+    }
+}
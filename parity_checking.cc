@@ -1,93 +1,804 @@
 #include "parity_checking.hpp"
+#include "parity_kernels.hpp"
+#include "parity_metrics.hpp"
+#include "parity_backend.hpp"
 #include <cstring>
+#include <cstdint>
 #include <algorithm>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <string>
+#include <bit>
+#include <cmath>
+#include <mutex>
 
 using std::min;
 
 
 namespace ParityChecking {
 
-    ParityHdr::ParityHdr() : check_sum{ 0 }, B{ 0 }, N{ 0 }, row_parities{ nullptr }, col_parities{ nullptr } { }
-    ParityHdr::ParityHdr(unsigned short B, unsigned short N, const unsigned char* byte_array)
+    namespace {
+        constexpr std::size_t CACHE_LINE{ 64 };
+        // Below this many bytes per task, thread startup costs more than the parity pass saves:
+        constexpr std::size_t MIN_BYTES_PER_TASK{ 1 << 18 };
+
+        std::size_t round_up(std::size_t n, std::size_t m) { return (n + m - 1) / m * m; }
+
+        /* The serialized ParityHdr (wire format, version 1). All fields are little endian,
+           fixed width and naturally aligned, and the whole header fits in one cache line:
+             offset  0: magic "PH"
+                     2: u8 version
+                     3: u8 flags (FLAG_CRC32C, or 0)
+                     4: u32 sum(row_parities) (mod 2^32), or with FLAG_CRC32C, the CRC-32C of
+                        all the other bytes (0-3, then 8 to the end.)
+                     8: u64 check_sum, u32 B, u32 N    -- the critical fields,
+                    24: u64 check_sum, u32 B, u32 N    -- doubly copied.
+                    40: row_parities (B bytes), then col_parities (N bytes).
+           Version 2, only written for a zero padded byte array (length < B * N), so unpadded
+           ParityHdrs stay readable by version 1 receivers, is version 1 with the true length
+           inserted before the parities:
+                    40: u64 length,
+                    48: u64 length                     -- doubly copied.
+                    56: row_parities (B bytes), then col_parities (N bytes). */
+        constexpr unsigned char MAGIC[2]{ 'P', 'H' };
+        constexpr unsigned char WIRE_VERSION{ 1 };
+        constexpr unsigned char WIRE_VERSION_PADDED{ 2 };
+        constexpr unsigned char FLAG_CRC32C{ 0x01 };
+        constexpr std::size_t CRITICAL_AT{ 8 };
+        constexpr std::size_t CRITICAL_LEN{ 8 + 4 + 4 };
+        constexpr std::size_t PARITIES_AT{ CRITICAL_AT + 2 * CRITICAL_LEN };
+        constexpr std::size_t LENGTH_AT{ PARITIES_AT };
+        constexpr std::size_t PADDED_PARITIES_AT{ LENGTH_AT + 2 * 8 };
+        static_assert(PARITIES_AT == SERIALIZED_FIELDS_SIZE);
+        static_assert(PADDED_PARITIES_AT == SERIALIZED_PADDED_FIELDS_SIZE);
+
+        // Little endian loads/stores (a compile time choice, so no branches at run time.)
+        template <typename T>
+        T to_from_le(T v) {
+            if constexpr (std::endian::native == std::endian::big) {
+                if constexpr (sizeof(T) == 2)
+                    return static_cast<T>(__builtin_bswap16(v));
+                else if constexpr (sizeof(T) == 4)
+                    return static_cast<T>(__builtin_bswap32(v));
+                else
+                    return static_cast<T>(__builtin_bswap64(v));
+            }
+            return v;
+        }
+        template <typename T>
+        void store_le(unsigned char* p, T v) {
+            v = to_from_le(v);
+            std::memcpy(p, &v, sizeof v);
+        }
+        template <typename T>
+        T load_le(const unsigned char* p) {
+            T v;
+            std::memcpy(&v, p, sizeof v);
+            return to_from_le(v);
+        }
+
+        std::uint32_t crc_of_serialized(const unsigned char* ser_PH, std::size_t len) {
+            // CRC-32C of the len byte serialized ParityHdr, skipping the field the crc goes in.
+            return kernels::crc32c(ser_PH + 8, len - 8, kernels::crc32c(ser_PH, 4));
+        }
+
+        void check_layout(const Layout& layout, std::size_t B, std::size_t N, const char* what) {
+            std::size_t min_pitch = layout.order == Layout::Order::RowMajor ? N : B;
+            if (layout.pitch != 0 && layout.pitch < min_pitch)
+                throw PC_Exception{ what };
+        }
+
+        void layout_parities(const unsigned char* byte_array, std::size_t B, std::size_t N,
+            const Layout& layout, unsigned char* row_parities, unsigned char* col_parities) {
+            /* calculate_parities for a B x N byte_array in any layout: row-major through its' own
+               (cache blocked) kernel, strided column-major a col at a time. */
+            if (B == 0 || N == 0) {  // (no bytes, so all the parities are 0.)
+                if (B)
+                    std::memset(row_parities, 0, B);
+                if (N)
+                    std::memset(col_parities, 0, N);
+                return;
+            }
+            std::memset(row_parities, 0, B);
+            if (layout.order == Layout::Order::RowMajor)
+                kernels::accumulate_rows(byte_array, layout.pitch ? layout.pitch : N, B, N,
+                    row_parities, col_parities);
+            else if (layout.packed_col_major(B))
+                kernels::accumulate_cols(byte_array, B, N, row_parities, col_parities);
+            else
+                for (std::size_t j = 0; j < N; ++j)
+                    kernels::accumulate_cols(byte_array + j * layout.pitch, B, 1, row_parities,
+                        col_parities + j);
+        }
+
+        struct ColumnPass {
+            /* A calculate_parities pass over a (column-major) byte array arriving in consecutive
+               chunks of any size, e.g. a ParityHdrBuilder's or a list of Segments. Whole cols go
+               straight through the cols kernel, and a chunk boundary part way down a col just
+               leaves that cols' running fold in col_fold until the rest of it arrives.
+               row_parities must start zeroed. */
+            std::size_t B;
+            unsigned char* row_parities;
+            unsigned char* col_parities;
+            std::size_t pos;               // bytes consumed so far.
+            unsigned char col_fold;        // XOR of the bytes consumed so far of the col at pos.
+
+            void update(const unsigned char* chunk, std::size_t len) {
+                while (len > 0) {
+                    std::size_t row = pos % B;
+                    if (row == 0 && len >= B) {
+                        std::size_t n_cols = len / B;
+                        kernels::accumulate_cols(chunk, B, n_cols, row_parities, col_parities + pos / B);
+                        n_cols *= B;
+                        pos += n_cols;
+                        chunk += n_cols;
+                        len -= n_cols;
+                        continue;
+                    }
+                    std::size_t n = min<std::size_t>(len, B - row);
+                    col_fold ^= kernels::xor_accumulate(row_parities + row, chunk, n);
+                    if (row + n == B) {  // that completed the col.
+                        col_parities[pos / B] = kernels::parity(col_fold);
+                        col_fold = 0;
+                    }
+                    pos += n;
+                    chunk += n;
+                    len -= n;
+                }
+            }
+
+            void pad_to(std::size_t N) {
+                /* Ends the pass at pos, the rest of the N cols being zero padding. */
+                std::size_t j = B ? pos / B : 0;
+                if (B && pos % B != 0)
+                    col_parities[j++] = kernels::parity(col_fold);
+                if (j < N)
+                    std::memset(col_parities + j, 0, N - j);
+            }
+        };
+
+        std::size_t total_len(std::span<const Segment> segments) {
+            std::size_t len = 0;
+            for (const Segment& seg : segments)
+                len += seg.len;
+            return len;
+        }
+    }
+
+    Executor thread_executor() {
+        return [](unsigned n_tasks, const std::function<void(unsigned)>& task) {
+            // The calling thread runs task 0 itself rather than idling in join().
+            std::vector<std::thread> threads;
+            threads.reserve(n_tasks > 0 ? n_tasks - 1 : 0);
+            for (unsigned t = 1; t < n_tasks; ++t)
+                threads.emplace_back(task, t);
+            if (n_tasks > 0)
+                task(0);
+            for (auto& th : threads)
+                th.join();
+        };
+    }
+
+    Shape choose_shape(std::size_t len) {
+        /* B + ceil(len / B) is least at B == sqrt(len), and grows only slowly away from it, so
+           of the multiples of SHAPE_ALIGN either side of sqrt(len), take the one giving the
+           smaller B + N (on a tie, the less padding.) */
+        if (len == 0)
+            throw PC_Exception{ "In choose_shape, len must be non zero.\n" };
+        auto root = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(len)));
+        while (root * root > len)  // (correct the double's rounding either way.)
+            --root;
+        while ((root + 1) * (root + 1) <= len)
+            ++root;
+        std::uint64_t below = std::max<std::uint64_t>(SHAPE_ALIGN, root / SHAPE_ALIGN * SHAPE_ALIGN);
+        Shape best{ 0, 0 };
+        std::uint64_t best_cost{ 0 }, best_padding{ 0 };
+        for (std::uint64_t B : { below, below + SHAPE_ALIGN }) {
+            std::uint64_t N = (len + B - 1) / B;
+            if (B > UINT32_MAX || N > UINT32_MAX)
+                continue;
+            std::uint64_t cost = B + N, padding = B * N - len;
+            if (best.B == 0 || cost < best_cost || (cost == best_cost && padding < best_padding)) {
+                best = { static_cast<std::uint32_t>(B), static_cast<std::uint32_t>(N) };
+                best_cost = cost;
+                best_padding = padding;
+            }
+        }
+        if (best.B == 0)
+            throw PC_Exception{ "In choose_shape, len too large for 32 bit B and N.\n" };
+        return best;
+    }
+
+    ParityHdr::ParityHdr() : ParityHdr(std::pmr::get_default_resource()) { }
+    ParityHdr::ParityHdr(std::pmr::memory_resource* resource)
+        : check_sum{ 0 }, B{ 0 }, N{ 0 }, length{ 0 }, row_parities{ nullptr }, col_parities{ nullptr },
+        row_capacity{ 0 }, col_capacity{ 0 }, resource{ resource } { }
+    ParityHdr::ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array)
         /* length of byte_array == B * N, conceptualized as B rows, N cols of matrix
            of bytes whose row/col parities are stored in this ParityHdr. */
-        : B{ B }, N{ N } {
-        row_parities = new unsigned char[B];
-        col_parities = new unsigned char[N];
-        calculate_parities(byte_array); // fills in above 2 arrays.
+        : ParityHdr() {
+        reserve(B, N);
+        recompute(byte_array); // fills in row/col_parities and check_sum.
+    }
+    ParityHdr::ParityHdr(const unsigned char* byte_array, std::size_t length)
+        : ParityHdr() {
+        recompute(byte_array, length);
+    }
+    ParityHdr::ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array,
+        const Layout& layout)
+        : ParityHdr() {
+        reserve(B, N);
+        recompute(byte_array, layout);
+    }
+    ParityHdr::ParityHdr(std::uint32_t B, std::uint32_t N, std::span<const Segment> byte_array)
+        : ParityHdr() {
+        if (total_len(byte_array) != std::size_t{ B } * N)
+            throw PC_Exception{ "In ParityHdr, the segments don't total B * N bytes.\n" };
+        metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Compute };
+        metrics::count_hashed(std::size_t{ B } * N);
+        reserve(B, N);
+        if (B)
+            std::memset(row_parities, 0, B);
+        ColumnPass pass{ B, row_parities, col_parities, 0, 0 };
+        for (const Segment& seg : byte_array)
+            pass.update(seg.data, seg.len);
+        pass.pad_to(N);  // (only does anything for B == 0, when there are no bytes for the cols.)
+        check_sum = calc_check_sum();
+    }
+    ParityHdr::ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array,
+        unsigned n_threads)
+        : ParityHdr(B, N, byte_array, thread_executor(),
+            n_threads ? n_threads : std::max(1U, std::thread::hardware_concurrency())) { }
+    ParityHdr::ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array,
+        const Executor& executor, unsigned n_tasks)
+        : ParityHdr() {
+        reserve(B, N);
+        calculate_parities(byte_array, executor, n_tasks);
+        check_sum = calc_check_sum();
+    }
+
+    ParityHdr::ParityHdr(std::allocator_arg_t, std::pmr::memory_resource* resource, std::uint32_t B,
+        std::uint32_t N, const unsigned char* byte_array)
+        : ParityHdr(resource) {
+        reserve(B, N);
+        recompute(byte_array);
+    }
+
+    ParityHdr::ParityHdr(ParityHdr&& other) noexcept : ParityHdr() {
+        *this = std::move(other);
+    }
+
+    ParityHdr& ParityHdr::operator= (ParityHdr&& other) noexcept {
+        /* Takes other's storage (and so its resource), leaving other empty. other keeps its
+           resource too, so it may be reused, allocating from that again. */
+        if (this == &other)
+            return *this;
+        release();
+        resource = other.resource;
+        check_sum = std::exchange(other.check_sum, 0);
+        B = std::exchange(other.B, 0);
+        N = std::exchange(other.N, 0);
+        length = std::exchange(other.length, 0);
+        row_parities = std::exchange(other.row_parities, nullptr);
+        col_parities = std::exchange(other.col_parities, nullptr);
+        row_capacity = std::exchange(other.row_capacity, 0);
+        col_capacity = std::exchange(other.col_capacity, 0);
+        return *this;
+    }
+
+    void ParityHdr::reserve(std::uint32_t B, std::uint32_t N) {
+        /* Sets the dimensions, only reallocating the storage block when B or N outgrows it.
+           row_parities and col_parities share the one block, each part rounded up to a whole
+           number of cache lines, so both start cache line aligned and a second allocation (and
+           its header and fragmentation) is saved. Contents are unspecified on return. */
+        if (B > row_capacity || N > col_capacity) {
+            std::size_t rows = round_up(std::max<std::size_t>(B, row_capacity), CACHE_LINE);
+            std::size_t cols = round_up(std::max<std::size_t>(N, col_capacity), CACHE_LINE);
+            auto* block = static_cast<unsigned char*>(resource->allocate(rows + cols, CACHE_LINE));
+            release();
+            row_parities = block;
+            col_parities = block + rows;
+            row_capacity = rows;
+            col_capacity = cols;
+        }
+        this->B = B;
+        this->N = N;
+        length = std::uint64_t{ B } * N;
+    }
+
+    void ParityHdr::release() {
+        if (row_parities)
+            resource->deallocate(row_parities, row_capacity + col_capacity, CACHE_LINE);
+        row_parities = col_parities = nullptr;
+        row_capacity = col_capacity = 0;
+    }
+
+    void ParityHdr::reset(std::uint32_t B, std::uint32_t N) {
+        /* Gives the ParityHdr of an all zero B * N byte array, reusing storage when it fits. */
+        reserve(B, N);
+        if (B)
+            std::memset(row_parities, 0, B);
+        if (N)
+            std::memset(col_parities, 0, N);
+        check_sum = calc_check_sum();
+    }
+
+    void ParityHdr::recompute(const unsigned char* byte_array) {
+        /* Recalculate in place for a new byte array of the current dimensions B x N (and
+           length.) */
+        calculate_parities(byte_array);
+        check_sum = calc_check_sum();
+    }
+
+    void ParityHdr::recompute(const unsigned char* byte_array, const Layout& layout) {
+        /* Recalculate in place for a new B x N byte array laid out as layout says. */
+        if (layout.packed_col_major(B)) {
+            recompute(byte_array);
+            return;
+        }
+        check_layout(layout, B, N, "In ParityHdr::recompute, layout pitch smaller than a row/col.\n");
+        if (length != std::uint64_t{ B } * N)
+            throw PC_Exception{ "In ParityHdr::recompute, a zero padded ParityHdr needs the default layout.\n" };
+        metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Compute };
+        metrics::count_hashed(std::size_t{ B } * N);
+        layout_parities(byte_array, B, N, layout, row_parities, col_parities);
+        check_sum = calc_check_sum();
+    }
+
+    void ParityHdr::recompute(const unsigned char* byte_array, std::size_t length) {
+        /* Recalculate in place for a new byte array of length bytes, in the choose_shape(length)
+           shape, reusing storage when it fits. */
+        Shape shape = choose_shape(length);
+        reserve(shape.B, shape.N);
+        this->length = length;
+        recompute(byte_array);
+    }
+
+    void ParityHdr::update_range(std::size_t offset, std::span<const unsigned char> old_bytes,
+        std::span<const unsigned char> new_bytes) {
+        /* Col by col through the range, XORing both the old and the new bytes into their
+           row_parities undoes the old bytes' share and adds the new's; the col parity flips if
+           the two XOR folds differ in parity. check_sum follows the changed row_parities' sums. */
+        if (old_bytes.size() != new_bytes.size())
+            throw PC_Exception{ "In ParityHdr::update_range, old_bytes and new_bytes differ in size.\n" };
+        if (offset > length || old_bytes.size() > length - offset)
+            throw PC_Exception{ "In ParityHdr::update_range, the range runs past the byte array's length.\n" };
+        metrics::count_updated(old_bytes.size());
+        auto sum = [](const unsigned char* p, std::size_t n) {
+            std::uint64_t s = 0;
+            for (std::size_t k = 0; k < n; ++k)
+                s += p[k];
+            return s;
+        };
+        for (std::size_t k = 0; k < old_bytes.size(); ) {
+            const std::size_t i = (offset + k) % B;
+            const std::size_t j = (offset + k) / B;
+            const std::size_t n = std::min<std::size_t>(B - i, old_bytes.size() - k);
+            unsigned char* rows = row_parities + i;
+            check_sum -= sum(rows, n);
+            unsigned char fold = kernels::xor_accumulate(rows, old_bytes.data() + k, n);
+            fold ^= kernels::xor_accumulate(rows, new_bytes.data() + k, n);
+            check_sum += sum(rows, n);
+            if (kernels::parity(fold)) {
+                check_sum -= col_parities[j];
+                col_parities[j] ^= 1;
+                check_sum += col_parities[j];
+            }
+            k += n;
+        }
+    }
+
+    void ParityHdr::combine(const ParityHdrView& other) {
+        /* (Zero padding XORs to zero padding, so the longer length holds the result.) */
+        if (other.B != B || other.N != N)
+            throw PC_Exception{ "In ParityHdr::combine, the ParityHdrs' dimensions differ.\n" };
+        kernels::xor_accumulate(row_parities, other.row_parities, B);
+        kernels::xor_accumulate(col_parities, other.col_parities, N);
+        length = std::max(length, other.length);
         check_sum = calc_check_sum();
     }
 
     void ParityHdr::calculate_parities(const unsigned char* byte_array) {
+        /* byte_array is column-major (col j is bytes [j*B, (j+1)*B)), so row_parities is the
+           XOR of all N cols, and col j's parity is that of the XOR of its' B bytes.
+           The SIMD kernels do both in one pass over each col.
+           Only the length bytes of byte_array are read: after its' whole cols, the rest of the
+           last col is zero padding, adding nothing to the row parities, and any cols after
+           that are all padding (parity 0.) */
+        metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Compute };
+        metrics::count_hashed(length);
+        if (B == 0) {  // (no bytes, so every col's parity is 0.)
+            if (N)
+                std::memset(col_parities, 0, N);
+            return;
+        }
         std::memset(row_parities, 0, B);
-        std::memset(col_parities, 0, N);
-        int L = B * N;
-        for (int i = 0; i < L; ++i) {
-            row_parities[i % B] ^= byte_array[i];
-            col_parities[i / B] ^= byte_parity(byte_array[i]);
+        std::size_t full_cols = length / B;
+        kernels::accumulate_cols(byte_array, B, full_cols, row_parities, col_parities);
+        if (full_cols < N) {
+            col_parities[full_cols] = kernels::parity(kernels::xor_accumulate(row_parities,
+                byte_array + full_cols * B, length % B));
+            std::memset(col_parities + full_cols + 1, 0, N - full_cols - 1);
         }
 
         return;
     }
 
-    const unsigned char* ParityHdr::serialize() const {  // Typically used before transmitting.
+    void ParityHdr::calculate_parities(const unsigned char* byte_array, const Executor& executor,
+        unsigned n_tasks) {
+        /* Parallel calculate_parities: each task takes a contiguous slice of cols, writing its'
+           own slice of col_parities and XORing its' cols into a private row_parities accumulator.
+           The accumulators are then XOR reduced into row_parities.
+           Slices are whole multiples of a cache line of cols and accumulators are each padded
+           to whole cache lines, so tasks don't falsely share cache lines while running. */
+        std::size_t max_tasks = std::min(round_up(N, CACHE_LINE) / CACHE_LINE,
+            std::max<std::size_t>(1, std::size_t{ B } * N / MIN_BYTES_PER_TASK));
+        n_tasks = static_cast<unsigned>(std::min<std::size_t>(n_tasks, max_tasks));
+        if (n_tasks <= 1) {
+            calculate_parities(byte_array);
+            return;
+        }
+        metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Compute };
+        metrics::count_hashed(length);
+        std::size_t slice = round_up((N + n_tasks - 1) / n_tasks, CACHE_LINE);
+        n_tasks = static_cast<unsigned>((N + slice - 1) / slice);
+
+        // Task 0 accumulates straight into row_parities, the others into their own accumulator.
+        std::size_t stride = round_up(B, CACHE_LINE);
+        std::vector<unsigned char> acc_mem((n_tasks - 1) * stride + CACHE_LINE, 0);
+        unsigned char* accs = acc_mem.data() +
+            (CACHE_LINE - reinterpret_cast<std::uintptr_t>(acc_mem.data()) % CACHE_LINE) % CACHE_LINE;
+        std::memset(row_parities, 0, B);
+
+        executor(n_tasks, [&](unsigned t) {
+            std::size_t first_col = t * slice;
+            std::size_t n_cols = std::min(slice, N - first_col);
+            unsigned char* acc = t == 0 ? row_parities : accs + (t - 1) * stride;
+            kernels::accumulate_cols(byte_array + first_col * B, B, n_cols, acc, col_parities + first_col);
+        });
+
+        for (unsigned t = 1; t < n_tasks; ++t)
+            kernels::xor_accumulate(row_parities, accs + (t - 1) * stride, B);
+
+        return;
+    }
+
+    const unsigned char* ParityHdr::serialize(Integrity integrity) const {  // Typically used before transmitting.
         /* return a byte array with all the information tracked by this ParityHdr. */
-        int len = 3 * sizeof(int) + 4 * sizeof(short) + B + N;
+        std::size_t len = serialized_size();
         unsigned char* ser_PH = new unsigned char[len];
-        std::memcpy(ser_PH, this, sizeof(int) + 2 * sizeof(short));
-        std::memcpy(ser_PH + sizeof(int) + 2 * sizeof(short), this, sizeof(int) + 2 * sizeof(short));  // doubly copy critical info...
-        // insert additional check that row_parities sum is preserved:
-        unsigned int sum_row_parities{ 0 };
-        for (int b = 0; b < B; ++b)
-            sum_row_parities += row_parities[b];
-        std::memcpy(ser_PH + 2 * sizeof(int) + 4 * sizeof(short), &sum_row_parities, sizeof(int));
-
-        // Note: We're not copying the pointers, but the byte arrays pointed to:
-        std::memcpy(ser_PH + 3 * sizeof(int) + 4 * sizeof(short), row_parities, B);
-        std::memcpy(ser_PH + 3 * sizeof(int) + 4 * sizeof(short) + B, col_parities, N);
+        serialize_into({ ser_PH, len }, integrity);
         return ser_PH;
     }
 
+    std::size_t ParityHdr::serialized_size() const {
+        return ParityHdrView{ *this }.serialized_size();
+    }
+
+    std::size_t ParityHdr::serialize_into(std::span<unsigned char> buf, Integrity integrity) const {
+        return ParityHdrView{ *this }.serialize_into(buf, integrity);
+    }
+
     bool ParityHdr::load_from_serialized(const unsigned char* ser_PH) {
         /* Used to load received byte array of ParityHdr info into an empty ParityHdr.
-           returns bool indicating this load resulted in a good check_sum. */
-           // first confirm check_sum, B and N are very probably good, since we will be accessing 
-           // memory regions based on B and N below...
-        if (std::memcmp(ser_PH, ser_PH + sizeof(int) + 2 * sizeof(short), sizeof(int) + 2*sizeof(short)) != 0)
+           returns bool indicating this load resulted in a good check_sum.
+           The checks are those of ParityHdrView::load_from_serialized, and this ParityHdr is
+           left unchanged if they fail. */
+        ParityHdrView v;
+        if (!v.load_from_serialized(ser_PH))
             return false;
-        std::memcpy(this, ser_PH, sizeof(int) + 2*sizeof(short));
-        if (B + N > check_sum)
+        // load_from_serialized may be called repetitively, only reallocate if B or N grew:
+        reserve(v.B, v.N);
+        length = v.length;
+        check_sum = v.check_sum;
+        std::memcpy(row_parities, v.row_parities, B);
+        std::memcpy(col_parities, v.col_parities, N);
+        return true;
+    }
+
+    bool ParityHdr::confirm_check_sum() const {
+        return ParityHdrView{ *this }.confirm_check_sum();
+    }
+
+    std::uint64_t ParityHdr::calc_check_sum() const {
+        return ParityHdrView{ *this }.calc_check_sum();
+    }
+
+    ParityHdrView::ParityHdrView()
+        : check_sum{ 0 }, B{ 0 }, N{ 0 }, length{ 0 }, row_parities{ nullptr }, col_parities{ nullptr } { }
+    ParityHdrView::ParityHdrView(const ParityHdr& hdr)
+        : check_sum{ hdr.check_sum }, B{ hdr.B }, N{ hdr.N }, length{ hdr.length },
+        row_parities{ hdr.row_parities }, col_parities{ hdr.col_parities } { }
+
+    std::size_t ParityHdrView::serialized_size() const {
+        bool padded = length != std::uint64_t{ B } * N;
+        return (padded ? PADDED_PARITIES_AT : PARITIES_AT) + std::size_t{ B } + N;
+    }
+
+    std::size_t ParityHdrView::serialize_into(std::span<unsigned char> buf, Integrity integrity) const {
+        /* Writes the serialized ParityHdr into buf, returning the number of bytes written. */
+        std::size_t len = serialized_size();
+        if (buf.size() < len)
+            throw PC_Exception{ "In serialize_into, buffer smaller than serialized_size().\n" };
+        unsigned char* ser_PH = buf.data();
+        bool padded = length != std::uint64_t{ B } * N;
+        std::memcpy(ser_PH, MAGIC, sizeof MAGIC);
+        ser_PH[2] = padded ? WIRE_VERSION_PADDED : WIRE_VERSION;
+        ser_PH[3] = integrity == Integrity::CRC32C ? FLAG_CRC32C : 0;
+        store_le<std::uint64_t>(ser_PH + CRITICAL_AT, check_sum);
+        store_le<std::uint32_t>(ser_PH + CRITICAL_AT + 8, B);
+        store_le<std::uint32_t>(ser_PH + CRITICAL_AT + 12, N);
+        // doubly copy critical info...
+        std::memcpy(ser_PH + CRITICAL_AT + CRITICAL_LEN, ser_PH + CRITICAL_AT, CRITICAL_LEN);
+        std::size_t parities_at = PARITIES_AT;
+        if (padded) {
+            store_le<std::uint64_t>(ser_PH + LENGTH_AT, length);
+            store_le<std::uint64_t>(ser_PH + LENGTH_AT + 8, length);
+            parities_at = PADDED_PARITIES_AT;
+        }
+
+        // Note: We're not copying the pointers, but the byte arrays pointed to:
+        if (B)
+            std::memcpy(ser_PH + parities_at, row_parities, B);
+        if (N)
+            std::memcpy(ser_PH + parities_at + B, col_parities, N);
+
+        if (integrity == Integrity::CRC32C) {
+            store_le<std::uint32_t>(ser_PH + 4, crc_of_serialized(ser_PH, len));
+        }
+        else {  // insert additional check that row_parities sum is preserved:
+            std::uint32_t sum_row_parities{ 0 };
+            for (std::size_t b = 0; b < B; ++b)
+                sum_row_parities += row_parities[b];
+            store_le<std::uint32_t>(ser_PH + 4, sum_row_parities);
+        }
+        return len;
+    }
+
+    ParityHdrView::ParityHdrView(std::uint64_t check_sum, std::uint32_t B, std::uint32_t N,
+        const unsigned char* row_parities, const unsigned char* col_parities)
+        : check_sum{ check_sum }, B{ B }, N{ N }, length{ std::uint64_t{ B } * N },
+        row_parities{ row_parities }, col_parities{ col_parities } { }
+
+    bool ParityHdrView::load_from_serialized(const unsigned char* ser_PH) {
+        return load_from_serialized(ser_PH, SIZE_MAX);
+    }
+
+    namespace {
+        bool rejected(metrics::Reject reason) noexcept {
+            /* (load_from_serialized's failure, counted by reason.) */
+            metrics::count_reject(reason);
             return false;
+        }
+    }
+
+    bool ParityHdrView::load_from_serialized(const unsigned char* ser_PH, std::size_t len) {
+        /* Validates the received serialized ParityHdr, ser_PH, in place, and on success views
+           its' row/col parities directly in ser_PH.
+           returns bool indicating ser_PH is a ParityHdr with a good check_sum. */
+        if (len < PARITIES_AT)
+            return rejected(metrics::Reject::Truncated);
+        if (std::memcmp(ser_PH, MAGIC, sizeof MAGIC) != 0 ||
+            (ser_PH[2] != WIRE_VERSION && ser_PH[2] != WIRE_VERSION_PADDED) ||
+            (ser_PH[3] & ~FLAG_CRC32C) != 0)
+            return rejected(metrics::Reject::BadFormat);
+        // first confirm check_sum, B and N are very probably good, since we will be accessing 
+        // memory regions based on B and N below...
+        if (std::memcmp(ser_PH + CRITICAL_AT, ser_PH + CRITICAL_AT + CRITICAL_LEN, CRITICAL_LEN) != 0)
+            return rejected(metrics::Reject::BadCriticalFields);
+        ParityHdrView v;
+        v.check_sum = load_le<std::uint64_t>(ser_PH + CRITICAL_AT);
+        v.B = load_le<std::uint32_t>(ser_PH + CRITICAL_AT + 8);
+        v.N = load_le<std::uint32_t>(ser_PH + CRITICAL_AT + 12);
+        if (v.B == 0 || v.N == 0 || std::uint64_t{ v.B } + v.N > v.check_sum)
+            return rejected(metrics::Reject::BadCriticalFields);
+        v.length = std::uint64_t{ v.B } * v.N;
+        std::size_t parities_at = PARITIES_AT;
+        if (ser_PH[2] == WIRE_VERSION_PADDED) {
+            if (len < PADDED_PARITIES_AT)
+                return rejected(metrics::Reject::Truncated);
+            // the same for the length, which must leave some padding (else version 1 is sent):
+            if (std::memcmp(ser_PH + LENGTH_AT, ser_PH + LENGTH_AT + 8, 8) != 0)
+                return rejected(metrics::Reject::BadCriticalFields);
+            v.length = load_le<std::uint64_t>(ser_PH + LENGTH_AT);
+            if (v.length >= std::uint64_t{ v.B } * v.N)
+                return rejected(metrics::Reject::BadCriticalFields);
+            parities_at = PADDED_PARITIES_AT;
+        }
+        if (std::uint64_t{ v.B } + v.N > len - parities_at)
+            return rejected(metrics::Reject::Truncated);
+        v.row_parities = ser_PH + parities_at;
+        v.col_parities = v.row_parities + v.B;
+        if (ser_PH[3] & FLAG_CRC32C) {
+            // One pass over the whole ParityHdr, which then also vouches for the check_sum:
+            if (crc_of_serialized(ser_PH, parities_at + std::size_t{ v.B } + v.N) !=
+                load_le<std::uint32_t>(ser_PH + 4))
+                return rejected(metrics::Reject::BadCrc);
+            metrics::count_loaded();
+            *this = v;
+            return true;
+        }
         // and check row_parities sum was seperately preserved:
-        unsigned int sum_row_parities{ 0 };
-        for (int b = 0; b < B; ++b)
-            sum_row_parities += ser_PH[3 * sizeof(int) + 4 * sizeof(short) + b];
-        if (sum_row_parities != *reinterpret_cast<const unsigned int*>(ser_PH + 2 * sizeof(int) + 4*sizeof(short)))
-            return false;
-        delete[] row_parities;  // load_from_serialized may be called repetitively.
-        delete[] col_parities;
-        // Allocate heap memory to copy row/col_parities byte arrays into:
-        row_parities = new unsigned char[B];
-        std::memcpy(row_parities, ser_PH + 3 * sizeof(int) + 4 * sizeof(short), B);
-        col_parities = new unsigned char[N];
-        std::memcpy(col_parities, ser_PH + 3 * sizeof(int) + 4*sizeof(short) + B, N);
-        return confirm_check_sum();
+        std::uint32_t sum_row_parities{ 0 };
+        for (std::size_t b = 0; b < v.B; ++b)
+            sum_row_parities += v.row_parities[b];
+        if (sum_row_parities != load_le<std::uint32_t>(ser_PH + 4) || !v.confirm_check_sum())
+            return rejected(metrics::Reject::BadSum);
+        metrics::count_loaded();
+        *this = v;
+        return true;
     }
 
-    bool ParityHdr::confirm_check_sum() const {
+    bool ParityHdrView::confirm_check_sum() const {
         return check_sum == calc_check_sum();
     }
 
-    unsigned int ParityHdr::calc_check_sum() const {
-        unsigned int chk_sum{ static_cast<unsigned>(B + N) };
-        for (int i = 0; i < B; ++i)
+    std::uint64_t ParityHdrView::calc_check_sum() const {
+        std::uint64_t chk_sum{ std::uint64_t{ B } + N };
+        for (std::size_t i = 0; i < B; ++i)
             chk_sum += row_parities[i];
-        for (int j = 0; j < N; ++j)
+        for (std::size_t j = 0; j < N; ++j)
             chk_sum += col_parities[j];
         return chk_sum;
     }
 
-    void repair_byte_array(const ParityHdr& rcvd_hdr, const ParityHdr& t_hdr, unsigned char* t) {
+    namespace {
+        ParityMismatch collect_mismatch(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr) {
+            /* The mismatches between two same shape ParityHdrs, as verify would collect them. */
+            const unsigned char* rcvd_rows = rcvd_hdr.get_row_parities().data();
+            const unsigned char* t_rows = t_hdr.get_row_parities().data();
+            ParityMismatch mismatch;
+            kernels::find_mismatches(rcvd_hdr.get_col_parities().data(), t_hdr.get_col_parities().data(),
+                rcvd_hdr.getN(), 0, mismatch.cols);
+            kernels::find_mismatches(rcvd_rows, t_rows, rcvd_hdr.getB(), 0, mismatch.rows);
+            for (std::size_t row : mismatch.rows)
+                mismatch.row_flips.push_back(rcvd_rows[row] ^ t_rows[row]);
+            return mismatch;
+        }
+    }
+
+    namespace {
+        std::size_t find_only_mismatch(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t* at) noexcept {
+            /* The number (up to 2, where it stops looking) of k in [0, n) with a[k] != b[k], the
+               first such k in *at. Compares a cache line at a time, and never allocates. */
+            std::size_t found = 0;
+            for (std::size_t k = 0; k < n; k += CACHE_LINE) {
+                std::size_t len = min(CACHE_LINE, n - k);
+                if (std::memcmp(a + k, b + k, len) == 0)
+                    continue;
+                for (std::size_t m = k; m < k + len; ++m) {
+                    if (a[m] == b[m])
+                        continue;
+                    if (found++ > 0)
+                        return found;
+                    *at = m;
+                }
+            }
+            return found;
+        }
+
+        RepairStatus locate(std::size_t n_cols, std::size_t col, std::size_t n_rows, std::size_t row,
+            unsigned char flips, std::size_t* i, std::size_t* j) noexcept {
+            /* The single bad bit, from the n_cols bad cols (the first being col) and n_rows bad
+               byte rows (the first being row, whose bad bits are the 1s of flips.) Cols are
+               checked first, as find_error_locations always has. */
+            RepairStatus status = RepairStatus::Ok;
+            if (n_cols == 0)
+                status = RepairStatus::NoBadCol;
+            else if (n_cols > 1)
+                status = RepairStatus::SeveralBadCols;
+            else if (n_rows == 0)
+                status = RepairStatus::NoBadRow;
+            else if (n_rows > 1)
+                status = RepairStatus::SeveralBadRows;
+            else if (std::popcount(flips) != 1)  // > 0 because bad byte.
+                status = RepairStatus::SeveralBadBits;
+            else {
+                // The flipped bit is bit 0x80 >> b of the byte, so bit row 8 * row + b:
+                *i = 8 * row + std::countl_zero(flips);
+                *j = col;
+            }
+            metrics::count_locate(status);
+            return status;
+        }
+
+        RepairStatus repaired(RepairStatus status) noexcept {
+            /* (A try_repair_byte_array result, counted.) */
+            metrics::count_repair(status);
+            if (status == RepairStatus::Ok)
+                metrics::count_bits_corrected(1);
+            return status;
+        }
+
+        Correction& corrected(Correction& correction) noexcept {
+            /* (A correct_byte_array result, counted.) */
+            metrics::count_correction(correction.status);
+            metrics::count_bits_corrected(correction.flipped.size());
+            return correction;
+        }
+
+        bool in_padding(const ParityHdrView& hdr, std::size_t i, std::size_t j) noexcept {
+            /* Whether bit row i of col j lies past the length bytes of hdr's byte array. */
+            return j * std::uint64_t{ hdr.getB() } + i / 8 >= hdr.get_length();
+        }
+
+        RepairStatus flip_bit(const ParityHdrView& hdr, std::size_t i, std::size_t j,
+            unsigned char* t, const Layout& layout) noexcept {
+            /* Flips back the located bad bit of t, unless it is in the (implicit) zero padding. */
+            if (in_padding(hdr, i, j))
+                return RepairStatus::BadBitInPadding;
+            t[layout.offset(hdr.getB(), hdr.getN(), i / 8, j)] ^= 0x80 >> i % 8;
+            return RepairStatus::Ok;
+        }
+
+        unsigned char* byte_at(std::span<const Segment> t, std::size_t offset) noexcept {
+            /* The byte offset bytes into the segments' concatenation, nullptr past their end. */
+            for (const Segment& seg : t) {
+                if (offset < seg.len)
+                    return seg.data + offset;
+                offset -= seg.len;
+            }
+            return nullptr;
+        }
+
+        RepairStatus flip_bit(const ParityHdrView& hdr, std::size_t i, std::size_t j,
+            std::span<const Segment> t) noexcept {
+            if (in_padding(hdr, i, j))
+                return RepairStatus::BadBitInPadding;
+            unsigned char* byte = byte_at(t, j * hdr.getB() + i / 8);
+            if (!byte)
+                return RepairStatus::DimensionMismatch;
+            *byte ^= 0x80 >> i % 8;
+            return RepairStatus::Ok;
+        }
+
+        Correction locate_in(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch) {
+            /* As locate_errors, less the locations in rcvd_hdr's zero padding, which can't have
+               flipped (and aren't in t.) */
+            Correction correction = locate_errors(mismatch);
+            auto padding = [&](const BitLocation& bit) { return in_padding(rcvd_hdr, bit.i, bit.j); };
+            std::erase_if(correction.flipped, padding);
+            std::erase_if(correction.candidates, padding);
+            using Status = Correction::Status;
+            if ((correction.status == Status::Corrected && correction.flipped.empty()) ||
+                (correction.status == Status::Ambiguous && correction.candidates.empty()))
+                correction.status = Status::Uncorrectable;
+            return correction;
+        }
+
+        [[noreturn]] void throw_for(RepairStatus status) {
+            /* The exceptions the throwing repair_byte_array/find_error_locations have always
+               thrown for each status (other than Ok and NoRepairNeeded.) */
+            if (status == RepairStatus::BadCheckSum)
+                throw std::runtime_error("BadCheckSum() in repair_byte_array");
+            if (status == RepairStatus::DimensionMismatch)
+                throw std::runtime_error("ParityHdr DimensionMismatch in repair_byte_array.");
+            if (status == RepairStatus::BadBitInPadding)
+                throw PC_Exception{ "In repair_byte_array, the bad bit located is in the zero padding.\n" };
+            throw PC_Exception{ (std::string{ "In find_error_locations, " } + status_message(status) + "\n").c_str() };
+        }
+    }
+
+    const char* status_message(RepairStatus status) noexcept {
+        switch (status) {
+        case RepairStatus::Ok: return "Repaired.";
+        case RepairStatus::NoRepairNeeded: return "No repair needed.";
+        case RepairStatus::BadCheckSum: return "BadCheckSum()";
+        case RepairStatus::DimensionMismatch: return "ParityHdr DimensionMismatch.";
+        case RepairStatus::NoBadCol: return "Couldn't locate a col with a parity mismatch.";
+        case RepairStatus::SeveralBadCols: return "More than 1 col had a parity mismatch.";
+        case RepairStatus::NoBadRow: return "Couldn't locate a row with a parity mismatch.";
+        case RepairStatus::SeveralBadRows: return "More than 1 row had a parity mismatch.";
+        case RepairStatus::SeveralBadBits: return "More than 1 bad bit found in the bad byte.";
+        case RepairStatus::BadBitInPadding: return "The bad bit located is in the zero padding.";
+        }
+        return "Unknown RepairStatus.";
+    }
+
+    RepairStatus try_repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+        unsigned char* t, const Layout& layout) noexcept {
         /* Repairs the received byte array, t, by comparing the rcvd_hdr with the one
            constructed in the receiving process, t_hdr, describing t.
         */
@@ -96,27 +807,104 @@ namespace ParityChecking {
         // transmitted hdr, s_hdr(which we normally do not have), by checking the 
         // check_sum of rcvd_hdr. User normally does this prior to calling this fn.
         if (!rcvd_hdr.confirm_check_sum())
-            throw std::runtime_error("BadCheckSum() in repair_byte_array");
+            return repaired(RepairStatus::BadCheckSum);
 
         if (rcvd_hdr == t_hdr) // No repair needed. No need to call this fn in first place.
-            return;
+            return repaired(RepairStatus::NoRepairNeeded);
 
         // Following shouldn't fail as user should construct t_hdr from dimensions of rcvd_hdr:
-        if (rcvd_hdr.B != t_hdr.B || rcvd_hdr.N != t_hdr.N)
-            throw std::runtime_error("ParityHdr DimensionMismatch in repair_byte_array.");
+        if (rcvd_hdr.getB() != t_hdr.getB() || rcvd_hdr.getN() != t_hdr.getN() ||
+            rcvd_hdr.get_length() != t_hdr.get_length())
+            return repaired(RepairStatus::DimensionMismatch);
 
         // Get here only if row and/or col_parities arrays differ.
         // Now find locations of intersections of these differences (one for now).
-        int i{ -1 }, j{ -1 }; // i is bit row in [0, 8*B-1], j is bit col(==byte col) in [0, N-1].
-        find_error_locations(rcvd_hdr, t_hdr, &i, &j);
+        std::size_t i, j; // i is bit row in [0, 8*B-1], j is bit col(==byte col) in [0, N-1].
+        RepairStatus status = try_find_error_locations(rcvd_hdr, t_hdr, &i, &j);
+        if (status != RepairStatus::Ok)
+            return repaired(status);
 
         // Fix the bad bit: i is bit row, so locate byte first, then flip bit within that byte.
-        t[j * rcvd_hdr.B + i / 8] ^= 0x80 >> i % 8;
+        return repaired(flip_bit(rcvd_hdr, i, j, t, layout));
+    }
 
-        return;
+    RepairStatus try_repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+        unsigned char* t, const Layout& layout) noexcept {
+        if (mismatch.empty())
+            return repaired(RepairStatus::NoRepairNeeded);
+        std::size_t i, j;
+        RepairStatus status = try_find_error_locations(mismatch, &i, &j);
+        if (status != RepairStatus::Ok)
+            return repaired(status);
+        return repaired(flip_bit(rcvd_hdr, i, j, t, layout));
+    }
+
+    RepairStatus try_repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+        std::span<const Segment> t) noexcept {
+        if (mismatch.empty())
+            return repaired(RepairStatus::NoRepairNeeded);
+        std::size_t i, j;
+        RepairStatus status = try_find_error_locations(mismatch, &i, &j);
+        if (status != RepairStatus::Ok)
+            return repaired(status);
+        return repaired(flip_bit(rcvd_hdr, i, j, t));
+    }
+
+    RepairStatus try_find_error_locations(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+        std::size_t* i, std::size_t* j) noexcept {
+        /* Without collecting the mismatches into a ParityMismatch: it only matters whether
+           there are 0, 1 or more of them. */
+        const unsigned char* rcvd_rows = rcvd_hdr.get_row_parities().data();
+        const unsigned char* t_rows = t_hdr.get_row_parities().data();
+        std::size_t col{ 0 }, row{ 0 };
+        std::size_t n_cols = find_only_mismatch(rcvd_hdr.get_col_parities().data(),
+            t_hdr.get_col_parities().data(), rcvd_hdr.getN(), &col);
+        std::size_t n_rows = find_only_mismatch(rcvd_rows, t_rows, rcvd_hdr.getB(), &row);
+        unsigned char flips = n_rows ? rcvd_rows[row] ^ t_rows[row] : 0;
+        return locate(n_cols, col, n_rows, row, flips, i, j);
+    }
+
+    RepairStatus try_find_error_locations(const ParityMismatch& mismatch, std::size_t* i,
+        std::size_t* j) noexcept {
+        return locate(mismatch.cols.size(), mismatch.cols.empty() ? 0 : mismatch.cols[0],
+            mismatch.rows.size(), mismatch.rows.empty() ? 0 : mismatch.rows[0],
+            mismatch.row_flips.empty() ? 0 : mismatch.row_flips[0], i, j);
+    }
+
+    void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr, unsigned char* t,
+        const Layout& layout) {
+        /* try_repair_byte_array, throwing std::runtime_error on a bad check sum or dimensions
+           and PC_Exception (as find_error_locations) when the bad bit can't be located. */
+        RepairStatus status = try_repair_byte_array(rcvd_hdr, t_hdr, t, layout);
+        if (status != RepairStatus::Ok && status != RepairStatus::NoRepairNeeded)
+            throw_for(status);
     }
 
-    void find_error_locations(const ParityHdr& rcvd_hdr, const ParityHdr& t_hdr, int* i, int* j) {
+    void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch, unsigned char* t,
+        const Layout& layout) {
+        /* Repairs t using the mismatches verify(rcvd_hdr, t, mismatch) collected, so only the
+           bad byte itself is touched after the verify pass. Throws as repair_byte_array above. */
+        RepairStatus status = try_repair_byte_array(rcvd_hdr, mismatch, t, layout);
+        if (status != RepairStatus::Ok && status != RepairStatus::NoRepairNeeded)
+            throw_for(status);
+    }
+
+    void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+        std::span<const Segment> t) {
+        RepairStatus status = try_repair_byte_array(rcvd_hdr, mismatch, t);
+        if (status != RepairStatus::Ok && status != RepairStatus::NoRepairNeeded)
+            throw_for(status);
+    }
+
+    void find_error_locations(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr, std::size_t* i, std::size_t* j) {
+        /* Locates the bad bit from the mismatches between rcvd_hdr and t_hdr, as
+           find_error_locations(mismatch, i, j) below does. */
+        RepairStatus status = try_find_error_locations(rcvd_hdr, t_hdr, i, j);
+        if (status != RepairStatus::Ok)
+            throw_for(status);
+    }
+
+    void find_error_locations(const ParityMismatch& mismatch, std::size_t* i, std::size_t* j) {
         /*
         On return, *i is the bit row in [0, 8*B-1], and *j is the col in [0, N-1], that contain the
         bad(flipped) bit (their intersection in the 8B x N matrix of bits is the bad bit.)
@@ -129,65 +917,584 @@ namespace ParityChecking {
         When transmission errors are caught and the what() msg printed, they tend to be:
           "More than 1 col had a parity mismatch." -This is because col parities are checked before
           row parities so the many bad bits will throw that message first..
+        try_find_error_locations reports the same cases as a RepairStatus instead.
         */
+        RepairStatus status = try_find_error_locations(mismatch, i, j);
+        if (status != RepairStatus::Ok)
+            throw_for(status);
+    }
 
-        // First find the col, *j in [0, N-1], flipped bit is in:
-        int n_errors = 0;  // used to count bad bits (aka: bit flips)
-        for (int col = 0; col < rcvd_hdr.N; ++col) {
-            if (rcvd_hdr.col_parities[col] != t_hdr.col_parities[col]) {
-                n_errors += 1;
-                *j = col;
-            }
+    Correction locate_errors(const ParityMismatch& mismatch) {
+        /* Each flip toggles the parity of its bit row and of its col, so the fewest flips
+           explaining a bad bit rows and c bad cols number max(a, c). a and c must have the same
+           parity, as both are the number of flips mod 2. Only for a == c == 1 are those fewest
+           flips unique: a == c == k > 1 bad rows and cols pair up k! ways, and for a > c the
+           extra bad rows can pair up within any of the good cols as well (or vice versa.) */
+        Correction correction;
+        std::vector<std::size_t> bit_rows;
+        for (std::size_t k = 0; k < mismatch.rows.size(); ++k)
+            for (int b = 0; b < 8; ++b)
+                if (mismatch.row_flips[k] & (0x80 >> b))
+                    bit_rows.push_back(8 * mismatch.rows[k] + b);
+        const std::size_t a = bit_rows.size(), c = mismatch.cols.size();
+
+        using Status = Correction::Status;
+        if (a == 0 && c == 0)
+            return correction;
+        if (a == 0 || c == 0 || (a - c) % 2 != 0) {
+            correction.status = Status::Uncorrectable;
+            return correction;
         }
-        if (n_errors == 0)
-            throw PC_Exception{ "In find_error_locations, Couldn't locate a col with a parity mismatch.\n" };
-        if (n_errors > 1)
-            throw PC_Exception{ "In find_error_locations, More than 1 col had a parity mismatch.\n" };
+        correction.status = a == 1 && c == 1 ? Status::Corrected : Status::Ambiguous;
+        std::vector<BitLocation>& locations =
+            correction.status == Status::Corrected ? correction.flipped : correction.candidates;
+        locations.reserve(a * c);
+        for (std::size_t j : mismatch.cols)
+            for (std::size_t i : bit_rows)
+                locations.push_back({ i, j });
+        return correction;
+    }
 
-        // Find byte row in [0, B-1] with error:
-        n_errors = 0;
-        for (int row = 0; row < rcvd_hdr.B; ++row) {
-            if (rcvd_hdr.row_parities[row] != t_hdr.row_parities[row]) {
-                n_errors += 1;
-                *i = row;  // save byte row with error.
-            }
+    Correction correct_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+        unsigned char* t, const Layout& layout) {
+        Correction correction = locate_in(rcvd_hdr, mismatch);
+        for (const BitLocation& bit : correction.flipped)
+            t[layout.offset(rcvd_hdr.getB(), rcvd_hdr.getN(), bit.i / 8, bit.j)] ^= 0x80 >> bit.i % 8;
+        return corrected(correction);
+    }
+
+    Correction correct_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+        std::span<const Segment> t) {
+        /* Segments not adding up to rcvd_hdr's length are Uncorrectable, with nothing flipped,
+           rather than leave a bad bit beyond them unflipped and report it as Corrected. */
+        Correction correction;
+        if (total_len(t) != rcvd_hdr.get_length())
+            correction.status = Correction::Status::Uncorrectable;
+        else
+            correction = locate_in(rcvd_hdr, mismatch);
+        for (const BitLocation& bit : correction.flipped)
+            *byte_at(t, bit.j * rcvd_hdr.getB() + bit.i / 8) ^= 0x80 >> bit.i % 8;
+        return corrected(correction);
+    }
+
+    Correction correct_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+        unsigned char* t, const Layout& layout) {
+        if (!rcvd_hdr.confirm_check_sum())
+            throw std::runtime_error("BadCheckSum() in correct_byte_array");
+        if (rcvd_hdr.getB() != t_hdr.getB() || rcvd_hdr.getN() != t_hdr.getN() ||
+            rcvd_hdr.get_length() != t_hdr.get_length())
+            throw std::runtime_error("ParityHdr DimensionMismatch in correct_byte_array.");
+        return correct_byte_array(rcvd_hdr, collect_mismatch(rcvd_hdr, t_hdr), t, layout);
+    }
+
+    std::vector<ByteRange> damaged_regions(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch) {
+        const std::size_t B = rcvd_hdr.getB(), length = rcvd_hdr.get_length();
+        std::vector<ByteRange> regions;
+        if (mismatch.cols.empty()) {
+            if (!mismatch.rows.empty())
+                regions.push_back({ 0, length });
+            return regions;
+        }
+        // mismatch.cols is in increasing order, so runs of adjacent cols are consecutive in it:
+        for (std::size_t k = 0; k < mismatch.cols.size(); ) {
+            std::size_t first = mismatch.cols[k], last = first;
+            while (++k < mismatch.cols.size() && mismatch.cols[k] == last + 1)
+                ++last;
+            if (first * B >= length)  // (cols all zero padding.)
+                break;
+            regions.push_back({ first * B, min((last + 1) * B, length) - first * B });
         }
-        if (n_errors == 0)
-            throw PC_Exception{ "In find_error_locations, Couldn't locate a row with a parity mismatch.\n" };
-        if (n_errors > 1)
-            throw PC_Exception{ "In find_error_locations, More than 1 row had a parity mismatch.\n" };
+        return regions;
+    }
 
-        // Find which bit, flipped_bit, within the byte row with parity mismatch, *i, is flipped:
-        unsigned char flips = rcvd_hdr.row_parities[*i] ^ t_hdr.row_parities[*i]; // 1s at flipped bits.
-        int flipped_bit{ -1 };
-        int cnt{ 0 };    // number of bit flips found within the 1 bad byte, *i.
-        for (int b = 0; b < 8; ++b) {
-            if (0x80 & flips) {
-                flipped_bit = b;
-                ++cnt;
+    namespace {
+        bool verify_pass(const ParityHdrView& rcvd_hdr, const unsigned char* t, ParityMismatch* mismatch) {
+            /* The calculate_parities pass over t, fused with the comparison against rcvd_hdr:
+               cols are processed in blocks of VERIFY_BLOCK, whose col parities are compared as
+               soon as they are calculated. Without a mismatch to fill in, a damaged t is then
+               (usually) rejected part way through; with one, the differing cols and rows are
+               collected from SIMD compare masks as the pass goes. The only state is t's
+               running row parities (thread_local, so reused between calls.)
+               As in calculate_parities, only the length bytes of t are read, any zero padding
+               after them being implicit. */
+            constexpr std::size_t VERIFY_BLOCK{ 256 };
+            const std::size_t B = rcvd_hdr.getB(), N = rcvd_hdr.getN(), length = rcvd_hdr.get_length();
+            metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Verify };
+            metrics::count_verified(length);
+            if (B == 0 || N == 0)  // (an empty t, whose parities are all 0, as rcvd_hdr's must be.)
+                return true;
+            const std::size_t full_cols = length / B;
+            const unsigned char* rcvd_rows = rcvd_hdr.get_row_parities().data();
+            const unsigned char* rcvd_cols = rcvd_hdr.get_col_parities().data();
+            thread_local std::vector<unsigned char> row_parities;
+            row_parities.assign(B, 0);
+            unsigned char col_parities[VERIFY_BLOCK];
+            bool match = true;
+            auto compare_cols = [&](std::size_t j, std::size_t n_cols) {
+                // false to stop the pass early.
+                if (std::memcmp(col_parities, rcvd_cols + j, n_cols) == 0)
+                    return true;
+                match = false;
+                if (mismatch)
+                    kernels::find_mismatches(col_parities, rcvd_cols + j, n_cols, j, mismatch->cols);
+                return mismatch != nullptr;
+            };
+            for (std::size_t j = 0; j < full_cols; j += VERIFY_BLOCK) {
+                std::size_t n_cols = min(VERIFY_BLOCK, full_cols - j);
+                kernels::accumulate_cols(t + j * B, B, n_cols, row_parities.data(), col_parities);
+                if (!compare_cols(j, n_cols))
+                    return false;
+            }
+            for (std::size_t j = full_cols; j < N; j += VERIFY_BLOCK) {
+                std::size_t n_cols = min(VERIFY_BLOCK, N - j);
+                std::memset(col_parities, 0, n_cols);
+                if (j == full_cols)  // the partial col of t's tail bytes.
+                    col_parities[0] = kernels::parity(kernels::xor_accumulate(row_parities.data(),
+                        t + j * B, length % B));
+                if (!compare_cols(j, n_cols))
+                    return false;
             }
-            flips <<= 1;
+            if (std::memcmp(row_parities.data(), rcvd_rows, B) == 0)
+                return match;
+            if (mismatch) {
+                kernels::find_mismatches(rcvd_rows, row_parities.data(), B, 0, mismatch->rows);
+                for (std::size_t row : mismatch->rows)
+                    mismatch->row_flips.push_back(rcvd_rows[row] ^ row_parities[row]);
+            }
+            return false;
         }
-        if (cnt != 1)   // cnt > 0 because bad byte.
-            throw PC_Exception{ "In find_error_locations, More than 1 bad bit found in the bad byte.\n" };
-        // Convert to bit row in [0, 8*B-1] this flipped bit lies:
-        *i = 8 * (*i) + flipped_bit;
 
-        return;
+        bool compare_parities(const ParityHdrView& rcvd_hdr, const unsigned char* parities,
+            ParityMismatch* mismatch) {
+            /* Whether the B + N parities (row_parities, then col_parities) of a received byte
+               array match rcvd_hdr's, collecting the mismatches into mismatch if not null. */
+            const std::size_t B = rcvd_hdr.getB(), N = rcvd_hdr.getN();
+            const unsigned char* rcvd_rows = rcvd_hdr.get_row_parities().data();
+            const unsigned char* rcvd_cols = rcvd_hdr.get_col_parities().data();
+            const unsigned char* rows = parities;
+            const unsigned char* cols = parities + B;
+            bool match = std::memcmp(rows, rcvd_rows, B) == 0 && std::memcmp(cols, rcvd_cols, N) == 0;
+            if (match || !mismatch)
+                return match;
+            kernels::find_mismatches(cols, rcvd_cols, N, 0, mismatch->cols);
+            kernels::find_mismatches(rcvd_rows, rows, B, 0, mismatch->rows);
+            for (std::size_t row : mismatch->rows)
+                mismatch->row_flips.push_back(rcvd_rows[row] ^ rows[row]);
+            return false;
+        }
+
+        bool verify_layout(const ParityHdrView& rcvd_hdr, const unsigned char* t, const Layout& layout,
+            ParityMismatch* mismatch) {
+            /* verify_pass for t in other layouts, whose cols can't be checked a block at a time
+               as they are calculated: t's parities are calculated in full (into thread_local
+               storage, reused between calls), then compared. */
+            const std::size_t B = rcvd_hdr.getB(), N = rcvd_hdr.getN();
+            check_layout(layout, B, N, "In verify, layout pitch smaller than a row/col.\n");
+            if (rcvd_hdr.get_length() != std::uint64_t{ B } * N)
+                throw PC_Exception{ "In verify, a zero padded ParityHdr needs the default layout.\n" };
+            metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Verify };
+            metrics::count_verified(B * N);
+            if (B == 0 || N == 0)  // (as in verify_pass.)
+                return true;
+            thread_local std::vector<unsigned char> parities;
+            parities.resize(B + N);
+            layout_parities(t, B, N, layout, parities.data(), parities.data() + B);
+            return compare_parities(rcvd_hdr, parities.data(), mismatch);
+        }
+
+        bool verify_segments(const ParityHdrView& rcvd_hdr, std::span<const Segment> t,
+            ParityMismatch* mismatch) {
+            /* As verify_layout, with t's parities from a ColumnPass over the segments. */
+            const std::size_t B = rcvd_hdr.getB(), N = rcvd_hdr.getN();
+            if (total_len(t) != rcvd_hdr.get_length())
+                throw PC_Exception{ "In verify, the segments' total length isn't the ParityHdr's.\n" };
+            metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Verify };
+            metrics::count_verified(rcvd_hdr.get_length());
+            if (B == 0 || N == 0)  // (as in verify_pass.)
+                return true;
+            thread_local std::vector<unsigned char> parities;
+            parities.assign(B + N, 0);
+            ColumnPass pass{ B, parities.data(), parities.data() + B, 0, 0 };
+            for (const Segment& seg : t)
+                pass.update(seg.data, seg.len);
+            pass.pad_to(N);
+            return compare_parities(rcvd_hdr, parities.data(), mismatch);
+        }
+    }
+
+    bool verify(const ParityHdrView& rcvd_hdr, std::span<const Segment> t) {
+        return verify_segments(rcvd_hdr, t, nullptr);
+    }
+
+    bool verify(const ParityHdrView& rcvd_hdr, std::span<const Segment> t, ParityMismatch& mismatch) {
+        mismatch.clear();
+        return verify_segments(rcvd_hdr, t, &mismatch);
+    }
+
+    bool verify(const ParityHdrView& rcvd_hdr, const unsigned char* t, const Layout& layout) {
+        if (!layout.packed_col_major(rcvd_hdr.getB()))
+            return verify_layout(rcvd_hdr, t, layout, nullptr);
+        return verify_pass(rcvd_hdr, t, nullptr);
+    }
+
+    bool verify(const ParityHdrView& rcvd_hdr, const unsigned char* t, ParityMismatch& mismatch,
+        const Layout& layout) {
+        mismatch.clear();
+        if (!layout.packed_col_major(rcvd_hdr.getB()))
+            return verify_layout(rcvd_hdr, t, layout, &mismatch);
+        return verify_pass(rcvd_hdr, t, &mismatch);
     }
 
-    bool operator== (const ParityHdr& lhs, const ParityHdr& rhs) {
+    bool operator== (const ParityHdrView& lhs, const ParityHdrView& rhs) {
         /* Not only do check_sums match(all you can do to compare received with transmitted),
            but also dimensions and row/col_parities match.  */
-        if (lhs.check_sum != rhs.check_sum || lhs.B != rhs.B || lhs.N != rhs.N)
+        if (lhs.check_sum != rhs.check_sum || lhs.B != rhs.B || lhs.N != rhs.N || lhs.length != rhs.length)
             return false;
-        if (std::memcmp(lhs.row_parities, rhs.row_parities, lhs.B) != 0)
+        if (lhs.B && std::memcmp(lhs.row_parities, rhs.row_parities, lhs.B) != 0)
             return false;
-        if (std::memcmp(lhs.col_parities, rhs.col_parities, lhs.N) != 0)
+        if (lhs.N && std::memcmp(lhs.col_parities, rhs.col_parities, lhs.N) != 0)
             return false;
 
         return true;
     }
 
+    ParityHdrBuilder::ParityHdrBuilder(std::uint32_t B, std::uint32_t N,
+        std::pmr::memory_resource* resource)
+        : B{ B }, N{ N }, pos{ 0 }, col_fold{ 0 }, hdr{ resource } {
+        if (B == 0 || N == 0)
+            throw PC_Exception{ "In ParityHdrBuilder, B and N must be non zero.\n" };
+        hdr.reset(B, N);
+    }
+
+    void ParityHdrBuilder::update(const unsigned char* chunk, std::size_t len) {
+        /* Continues the calculate_parities pass over the next len bytes of the byte array. */
+        if (len > std::size_t{ B } * N - pos)
+            throw PC_Exception{ "In ParityHdrBuilder::update, more than B * N bytes supplied.\n" };
+        metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Compute };
+        metrics::count_hashed(len);
+        ColumnPass pass{ B, hdr.row_parities, hdr.col_parities, pos, col_fold };
+        pass.update(chunk, len);
+        pos = pass.pos;
+        col_fold = pass.col_fold;
+    }
+
+    ParityHdr ParityHdrBuilder::finish() {
+        if (pos != std::size_t{ B } * N)
+            throw PC_Exception{ "In ParityHdrBuilder::finish, fewer than B * N bytes supplied.\n" };
+        hdr.check_sum = hdr.calc_check_sum();
+        ParityHdr done{ std::move(hdr) };
+        hdr.reset(B, N);  // starts the next byte array (allocating from the same resource.)
+        pos = 0;
+        col_fold = 0;
+        return done;
+    }
+
+    ParityHdrBatch::ParityHdrBatch(std::uint32_t B, std::uint32_t N,
+        std::pmr::memory_resource* resource)
+        : B{ B }, N{ N }, count{ 0 }, parities{ resource }, check_sums{ resource } { }
+
+    void ParityHdrBatch::resize(std::size_t count) {
+        this->count = count;
+        parities.resize(count * (std::size_t{ B } + N));  // (only allocates when the batch grows.)
+        check_sums.resize(count);
+    }
+
+    void ParityHdrBatch::compute(const unsigned char* const* byte_arrays, std::size_t count) {
+        resize(count);
+        for (std::size_t k = 0; k < count; ++k)
+            compute_one(k, byte_arrays[k]);
+    }
+
+    void ParityHdrBatch::compute(const unsigned char* base, std::size_t stride, std::size_t count) {
+        resize(count);
+        for (std::size_t k = 0; k < count; ++k)
+            compute_one(k, base + k * stride);
+    }
+
+    void ParityHdrBatch::compute(const unsigned char* base, std::size_t stride, std::size_t count,
+        const Executor& executor, unsigned n_tasks) {
+        /* Each task takes a contiguous run of the byte arrays; their parities are independent,
+           so there is nothing to reduce afterwards. */
+        std::size_t bytes = count * std::size_t{ B } * N;
+        n_tasks = static_cast<unsigned>(std::min<std::size_t>({ n_tasks, count,
+            std::max<std::size_t>(1, bytes / MIN_BYTES_PER_TASK) }));
+        if (n_tasks <= 1) {
+            compute(base, stride, count);
+            return;
+        }
+        resize(count);
+        std::size_t per_task = (count + n_tasks - 1) / n_tasks;
+        executor(n_tasks, [&](unsigned t) {
+            std::size_t last = std::min(count, (t + 1) * per_task);
+            for (std::size_t k = t * per_task; k < last; ++k)
+                compute_one(k, base + k * stride);
+        });
+    }
+
+    void ParityHdrBatch::compute(const unsigned char* base, std::size_t stride, std::size_t count,
+        backend::Backend& backend) {
+        /* The backend fills in the parities; the check_sums are then summed here. */
+        resize(count);
+        metrics::count_hashed(count * B * N);
+        backend.compute(B, N, base, stride, count, parities.data());
+        for (std::size_t k = 0; k < count; ++k) {
+            const unsigned char* rows = parities.data() + k * (std::size_t{ B } + N);
+            check_sums[k] = ParityHdrView{ 0, B, N, rows, rows + B }.calc_check_sum();
+        }
+    }
+
+    bool ParityHdrBatch::verify(const unsigned char* base, std::size_t stride,
+        std::vector<backend::TileReport>& bad, backend::Backend& backend) const {
+        metrics::count_verified(count * B * N);
+        return backend.verify(B, N, base, stride, count, parities.data(), bad);
+    }
+
+    void ParityHdrBatch::assign(std::size_t k, const ParityHdrView& hdr) {
+        unsigned char* rows = parities.data() + k * (std::size_t{ B } + N);
+        std::memcpy(rows, hdr.row_parities, B);
+        std::memcpy(rows + B, hdr.col_parities, N);
+        check_sums[k] = hdr.check_sum;
+    }
+
+    void ParityHdrBatch::compute_one(std::size_t k, const unsigned char* byte_array) {
+        metrics::ScopedCycles timer{ metrics::ScopedCycles::Pass::Compute };
+        metrics::count_hashed(std::size_t{ B } * N);
+        unsigned char* rows = parities.data() + k * (std::size_t{ B } + N);
+        std::memset(rows, 0, B);
+        kernels::accumulate_cols(byte_array, B, N, rows, rows + B);
+        check_sums[k] = ParityHdrView{ 0, B, N, rows, rows + B }.calc_check_sum();
+    }
+
+    ParityHdrView ParityHdrBatch::operator[](std::size_t k) const {
+        const unsigned char* rows = parities.data() + k * (std::size_t{ B } + N);
+        return ParityHdrView{ check_sums[k], B, N, rows, rows + B };
+    }
+
+    TiledParityHdr::TiledParityHdr(std::uint32_t tile_B, std::uint32_t tile_N,
+        std::pmr::memory_resource* resource)
+        : tiles{ tile_B, tile_N, resource } {
+        if (tile_B == 0 || tile_N == 0)
+            throw PC_Exception{ "In TiledParityHdr, tile_B and tile_N must be non zero.\n" };
+    }
+
+    void TiledParityHdr::compute(const unsigned char* buf, std::size_t len) {
+        compute(buf, len, thread_executor(), 1);
+    }
+
+    void TiledParityHdr::compute(const unsigned char* buf, std::size_t len, const Executor& executor,
+        unsigned n_tasks) {
+        if (len % tile_size() != 0)
+            throw PC_Exception{ "In TiledParityHdr::compute, len is not a whole number of tiles.\n" };
+        tiles.compute(buf, tile_size(), len / tile_size(), executor, n_tasks);
+    }
+
+    void TiledParityHdr::compute(const unsigned char* buf, std::size_t len, backend::Backend& backend) {
+        if (len % tile_size() != 0)
+            throw PC_Exception{ "In TiledParityHdr::compute, len is not a whole number of tiles.\n" };
+        tiles.compute(buf, tile_size(), len / tile_size(), backend);
+    }
+
+    std::size_t TiledParityHdr::serialized_size() const {
+        return tile_count() * (SERIALIZED_FIELDS_SIZE + tile_B() + tile_N());
+    }
+
+    std::size_t TiledParityHdr::serialize_into(std::span<unsigned char> buf, Integrity integrity) const {
+        if (buf.size() < serialized_size())
+            throw PC_Exception{ "In serialize_into, buffer smaller than serialized_size().\n" };
+        std::size_t len = 0;
+        for (std::size_t k = 0; k < tile_count(); ++k)
+            len += tile(k).serialize_into(buf.subspan(len), integrity);
+        return len;
+    }
+
+    bool TiledParityHdr::load_from_serialized(const unsigned char* ser_PH, std::size_t len) {
+        /* Validates all the tiles' serialized ParityHdrs before loading any of them, keeping
+           the views from that one parse (thread_local, so reused between calls.) */
+        const std::size_t tile_len = SERIALIZED_FIELDS_SIZE + tile_B() + tile_N();
+        if (len % tile_len != 0)
+            return false;
+        thread_local std::vector<ParityHdrView> views;
+        views.resize(len / tile_len);
+        for (std::size_t k = 0; k < views.size(); ++k) {
+            ParityHdrView& view = views[k];
+            if (!view.load_from_serialized(ser_PH + k * tile_len, len - k * tile_len) || view.getB() != tile_B() ||
+                view.getN() != tile_N() || view.get_length() != tile_size())
+                return false;
+        }
+        tiles.resize(views.size());
+        for (std::size_t k = 0; k < tile_count(); ++k)
+            tiles.assign(k, views[k]);
+        return true;
+    }
+
+    bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t, TiledMismatch& mismatch) {
+        return verify(rcvd_hdr, t, mismatch, thread_executor(), 1);
+    }
+
+    bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t, TiledMismatch& mismatch,
+        const Executor& executor, unsigned n_tasks) {
+        /* Each task verifies a contiguous run of tiles into their own per_tile entries (verify's
+           row accumulator is thread_local), then the bad ones are listed. */
+        const std::size_t count = rcvd_hdr.tile_count(), size = rcvd_hdr.tile_size();
+        mismatch.per_tile.resize(count);
+        mismatch.bad_tiles.clear();
+        n_tasks = static_cast<unsigned>(std::min<std::size_t>({ n_tasks, count,
+            std::max<std::size_t>(1, count * size / MIN_BYTES_PER_TASK) }));
+        auto verify_tiles = [&](std::size_t first, std::size_t last) {
+            for (std::size_t k = first; k < last; ++k)
+                verify(rcvd_hdr.tile(k), t + k * size, mismatch.per_tile[k]);
+        };
+        if (n_tasks <= 1)
+            verify_tiles(0, count);
+        else {
+            std::size_t per_task = (count + n_tasks - 1) / n_tasks;
+            executor(n_tasks, [&](unsigned task) {
+                verify_tiles(task * per_task, std::min(count, (task + 1) * per_task));
+            });
+        }
+        for (std::size_t k = 0; k < count; ++k)
+            if (!mismatch.per_tile[k].empty())
+                mismatch.bad_tiles.push_back(k);
+        return mismatch.bad_tiles.empty();
+    }
+
+    bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t,
+        std::vector<backend::TileReport>& bad, backend::Backend& backend) {
+        return rcvd_hdr.tiles.verify(t, rcvd_hdr.tile_size(), bad, backend);
+    }
+
+    std::vector<Correction> correct_byte_array(const TiledParityHdr& rcvd_hdr,
+        const TiledMismatch& mismatch, unsigned char* t) {
+        std::vector<Correction> corrections;
+        corrections.reserve(mismatch.bad_tiles.size());
+        for (std::size_t k : mismatch.bad_tiles)
+            corrections.push_back(correct_byte_array(rcvd_hdr.tile(k), mismatch.per_tile[k],
+                t + k * rcvd_hdr.tile_size()));
+        return corrections;
+    }
+
     PC_Exception::PC_Exception(const char* es) : runtime_error{ es } {}
+
+    namespace metrics {
+        namespace {
+            using detail::Counters;
+            using detail::N_COUNTERS;
+
+            // A thread's Counters, on the registry's list of running threads' from its' first
+            // count until it exits, when they are added into the registry's retired totals.
+            struct Slot {
+                Counters counters;
+                Slot* prev{ nullptr };
+                Slot* next{ nullptr };
+                Slot();
+                ~Slot();
+            };
+
+            struct Registry {
+                std::mutex mutex;
+                Slot* live{ nullptr };
+                std::array<std::uint64_t, N_COUNTERS> retired{ };
+            };
+
+            Registry& registry() {
+                /* (Never destroyed, as threads may still exit during static destruction.) */
+                static Registry* r = new Registry;
+                return *r;
+            }
+
+            thread_local bool exited{ false };
+
+            Slot::Slot() {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock{ r.mutex };
+                next = r.live;
+                if (next)
+                    next->prev = this;
+                r.live = this;
+            }
+
+            Slot::~Slot() {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock{ r.mutex };
+                for (std::size_t k = 0; k < N_COUNTERS; ++k)
+                    r.retired[k] += counters.counts[k].load(std::memory_order_relaxed);
+                (prev ? prev->next : r.live) = next;
+                if (next)
+                    next->prev = prev;
+                detail::local = nullptr;
+                exited = true;
+            }
+        }
+
+        Counters* detail::register_thread() noexcept {
+            /* Counts by other thread_local destructors run after the Slot's go nowhere. */
+            static Counters discarded;
+            if (exited)
+                return &discarded;
+            thread_local Slot slot;
+            local = &slot.counters;
+            return local;
+        }
+
+        std::uint64_t Snapshot::rejects() const {
+            std::uint64_t n = 0;
+            for (std::uint64_t count : header_rejects)
+                n += count;
+            return n;
+        }
+
+        std::uint64_t Snapshot::repairs_failed() const {
+            std::uint64_t n = 0;
+            for (std::size_t k = 0; k < N_REPAIR_STATUSES; ++k)
+                if (k != static_cast<std::size_t>(RepairStatus::Ok) &&
+                    k != static_cast<std::size_t>(RepairStatus::NoRepairNeeded))
+                    n += repairs[k];
+            return n;
+        }
+
+        namespace {
+            template <typename S, typename F>
+            void for_each_count(S& s, F f) {  // (S a Snapshot or const Snapshot.)
+                /* f(count, k) for each of the Snapshot's counts, and its' detail:: index. */
+                f(s.bytes_hashed, detail::BYTES_HASHED);
+                f(s.bytes_verified, detail::BYTES_VERIFIED);
+                f(s.bytes_updated, detail::BYTES_UPDATED);
+                f(s.headers_loaded, detail::HEADERS_LOADED);
+                for (std::size_t k = 0; k < N_REJECTS; ++k)
+                    f(s.header_rejects[k], detail::REJECTS + k);
+                for (std::size_t k = 0; k < N_REPAIR_STATUSES; ++k) {
+                    f(s.locates[k], detail::LOCATES + k);
+                    f(s.repairs[k], detail::REPAIRS + k);
+                }
+                for (std::size_t k = 0; k < N_CORRECTION_STATUSES; ++k)
+                    f(s.corrections[k], detail::CORRECTIONS + k);
+                f(s.bits_corrected, detail::BITS_CORRECTED);
+                f(s.compute_cycles, detail::COMPUTE_CYCLES);
+                f(s.verify_cycles, detail::VERIFY_CYCLES);
+            }
+        }
+
+        Snapshot operator- (const Snapshot& later, const Snapshot& earlier) {
+            std::array<std::uint64_t, N_COUNTERS> before;
+            for_each_count(earlier, [&](const std::uint64_t& count, std::size_t k) { before[k] = count; });
+            Snapshot s = later;
+            for_each_count(s, [&](std::uint64_t& count, std::size_t k) { count -= before[k]; });
+            return s;
+        }
+
+        Snapshot snapshot() {
+            Registry& r = registry();
+            std::array<std::uint64_t, N_COUNTERS> totals;
+            {
+                std::lock_guard<std::mutex> lock{ r.mutex };
+                totals = r.retired;
+                for (const Slot* slot = r.live; slot; slot = slot->next)
+                    for (std::size_t k = 0; k < N_COUNTERS; ++k)
+                        totals[k] += slot->counters.counts[k].load(std::memory_order_relaxed);
+            }
+            Snapshot s;
+            for_each_count(s, [&](std::uint64_t& count, std::size_t k) { count = totals[k]; });
+            return s;
+        }
+    }
 }
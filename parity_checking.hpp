@@ -7,7 +7,8 @@ for error correcting transmission of byte arrays.
 The ParityHdr class contains the parity information to be transmitted along with a
 byte array allowing to detect (and correct in low noise transmissions) transmission errors.
 Conceptually, the ParityHdr views the byte array as stored in a BxN matrix
-(B rows and N cols) of bytes, (and so the byte arrays' length must factor as B * N).
+(B rows and N cols) of bytes, (and so the byte arrays' length must factor as B * N, or else,
+choosing B and N itself, a ParityHdr treats a byte array of any length as zero padded up to B * N).
 The parity of the sequence of 8*B bits in each of the N cols is stored in the
 col_parities array (0s and 1s of length N bytes).
 The parity of the sequence of N bytes in each of the B rows is saved in the row_parities array
@@ -27,64 +28,296 @@ probability of error on any one bit, probabilites can be worked out after severa
 which allows correction of the bit at their intersection in the original byte array.
 Probability of error in ParityHdr is much smaller than for error in original byte array for long byte arrays.
 Parity errors in 2 rows and in 2 cols result in 4 ambiguous characters in the original byte array 
-corresponding to bit flips at the 4 possible intersections; these could be delt with in future versions.
+corresponding to bit flips at the 4 possible intersections; correct_byte_array reports these as
+candidates for the user to resolve
 (e.g., if english text is being transmitted, a dictionary of words can be used to aid reconstruction.)
-In this version, a maximum of 1 parity error per row and per col is allowed.
-If the number of rows with parity errors is not equal the number cols with parity errors, or this number 
-is larger than 1, the byte array is re-transmitted until it is.
+Only a single bad bit (1 bit row and 1 col with parity errors) has a unique fewest flips explanation,
+so that is all repair_byte_array or correct_byte_array will repair.
+Otherwise the byte array (or just its' damaged_regions) is re-transmitted until it can be repaired.
 etc.
 */
 #include <stdexcept>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <bit>
 
 namespace ParityChecking {
 
+  // An Executor runs task(0), ..., task(n_tasks - 1), possibly concurrently, and returns once
+  // they have all finished. Lets parallel ParityHdr construction run on a caller's thread pool.
+  using Executor = std::function<void(unsigned n_tasks, const std::function<void(unsigned)>& task)>;
+  Executor thread_executor();  // runs each task on its' own std::thread.
+
+  // How a serialized ParityHdr protects itself against corruption in transmission:
+  //  Sum    - the check_sum, plus a seperate sum of the row_parities (the original scheme.)
+  //  CRC32C - a CRC-32C over the whole serialized ParityHdr, checked in a single (hardware
+  //           accelerated) pass. Detects far more corruptions; e.g. offsetting ones that Sum misses.
+  enum class Integrity : unsigned char { Sum = 0, CRC32C = 1 };
+
+  // A serialized ParityHdr is this many bytes of fixed fields followed by its row/col_parities,
+  // or, of a zero padded byte array (length < B * N), SERIALIZED_PADDED_FIELDS_SIZE bytes.
+  constexpr std::size_t SERIALIZED_FIELDS_SIZE{ 40 };
+  constexpr std::size_t SERIALIZED_PADDED_FIELDS_SIZE{ 56 };
+
+  // The B x N a byte array of len bytes is viewed as when its' shape is left to ParityHdr:
+  // B the multiple of SHAPE_ALIGN nearest sqrt(len) (whole SIMD vectors per col) and
+  // N = ceil(len / B), whichever gives the least overhead B + N, which is then within about
+  // SHAPE_ALIGN bytes of its' 2 * sqrt(len) minimum. The zero padding, B * N - len, is under one col.
+  constexpr std::uint32_t SHAPE_ALIGN{ 16 };
+  struct Shape {
+    std::uint32_t B;
+    std::uint32_t N;
+  };
+  Shape choose_shape(std::size_t len);  // throws PC_Exception for len 0 or too large a len.
+
+  // Where the bytes of a B x N byte array are in memory, for those not packed column-major:
+  //  ColMajor - col j is the B bytes at byte_array + j * pitch (pitch >= B),
+  //  RowMajor - row r is the N bytes at byte_array + r * pitch (pitch >= N), e.g. an image of B
+  //             scanlines, or a table of B records, of N bytes each.
+  // pitch 0 means packed (B, or N.) The parities are those of the B x N matrix whatever its'
+  // layout, so a ParityHdr (and its' serialization) is the same as that of the packed
+  // column-major copy, and a sender and receiver may use different layouts. The default Layout
+  // is packed column-major, as ParityHdr has always assumed. (damaged_regions, whose byte
+  // ranges are whole cols, is only for that default.)
+  struct Layout {
+    enum class Order : unsigned char { ColMajor, RowMajor };
+    Order order{ Order::ColMajor };
+    std::size_t pitch{ 0 };
+
+    static Layout col_major(std::size_t pitch = 0) { return { Order::ColMajor, pitch }; }
+    static Layout row_major(std::size_t pitch = 0) { return { Order::RowMajor, pitch }; }
+    bool packed_col_major(std::size_t B) const { return order == Order::ColMajor && (pitch == 0 || pitch == B); }
+    // offset in the byte array of the byte in row (byte row) row, col col:
+    std::size_t offset(std::size_t B, std::size_t N, std::size_t row, std::size_t col) const {
+      return order == Order::RowMajor ? row * (pitch ? pitch : N) + col : col * (pitch ? pitch : B) + row;
+    }
+  };
+
+  // One piece of a byte array scattered over a chain of buffers (as a struct iovec): the byte
+  // array is the concatenation of the segments, in order. data is non-const, like iov_base, as
+  // the repair functions write through it; the ctor and verify only read.
+  struct Segment {
+    unsigned char* data;
+    std::size_t len;
+  };
+
+  class ParityHdrBuilder;
+  class ParityHdrView;
+  namespace backend {
+    class Backend;
+    struct TileReport;
+  }
+  template <std::size_t B, std::size_t N> class FixedParityHdr;
+
   class ParityHdr {
     public:
     ParityHdr(); 
     // Use this to construct ParityHdr corresponding to some byte array before transmitting:
-    ParityHdr(unsigned short B, unsigned short N, const unsigned char* byte_array);
-    ~ParityHdr() { delete[] row_parities; delete[] col_parities; }
+    ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array);
+    // or, for a byte array of any length, in the choose_shape(length) shape. The byte_array is
+    // read in place, the length bytes of it only, as if followed by zeros up to B * N:
+    ParityHdr(const unsigned char* byte_array, std::size_t length);
+    // or for a B x N byte array in another layout (e.g. row-major), read in place, so without a
+    // transposing copy first (throws PC_Exception if layout's pitch is too small):
+    ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array, const Layout& layout);
+    // or for a B * N byte array in segments (throws PC_Exception unless they total B * N bytes),
+    // each run through the kernels in place, so without first coalescing them into one buffer:
+    ParityHdr(std::uint32_t B, std::uint32_t N, std::span<const Segment> byte_array);
+    // The row/col_parities of a ParityHdr live in one cache line aligned block, normally from
+    // std::pmr::get_default_resource(). These take the memory_resource to allocate it from
+    // instead (e.g. a std::pmr::monotonic_buffer_resource arena for a whole request's headers):
+    explicit ParityHdr(std::pmr::memory_resource* resource);
+    ParityHdr(std::allocator_arg_t, std::pmr::memory_resource* resource, std::uint32_t B,
+      std::uint32_t N, const unsigned char* byte_array);
+    // or for very large byte arrays, split the N cols among n_threads threads
+    // (0 for std::thread::hardware_concurrency()), or among n_tasks tasks run by executor:
+    ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array, unsigned n_threads);
+    ParityHdr(std::uint32_t B, std::uint32_t N, const unsigned char* byte_array,
+      const Executor& executor, unsigned n_tasks);
+    ~ParityHdr() { release(); }
     ParityHdr(const ParityHdr& ) = delete;
     ParityHdr& operator= (const ParityHdr& ) = delete;
+    // Moves transfer the storage, so the moved to ParityHdr also takes the memory_resource:
+    ParityHdr(ParityHdr&& ) noexcept;
+    ParityHdr& operator= (ParityHdr&& ) noexcept;
+
+    // Reuse this ParityHdr's storage (only reallocated if it grows) for further byte arrays:
+    void reset(std::uint32_t B, std::uint32_t N);  // becomes ParityHdr of a zero B x N byte array.
+    void recompute(const unsigned char* byte_array); // for a byte array of the current length.
+    void recompute(const unsigned char* byte_array, const Layout& layout);  // (of B * N bytes.)
+    // or for a byte array of any length, reshaped to choose_shape(length) as that ctor does:
+    void recompute(const unsigned char* byte_array, std::size_t length);
+    // Both parities are XORs of the bytes, so a ParityHdr of a long lived byte array can follow
+    // in place writes to it in O(bytes written) rather than be recomputed: after the bytes at
+    // [offset, offset + old_bytes.size()) of the (column-major) byte array change from old_bytes
+    // to new_bytes (throws PC_Exception if the two differ in size, or run past the length):
+    void update_range(std::size_t offset, std::span<const unsigned char> old_bytes,
+      std::span<const unsigned char> new_bytes);
+    // and this becomes the ParityHdr of the XOR of its' byte array with other's, of the same
+    // B x N (throws PC_Exception otherwise.) E.g. combining with the ParityHdr of a delta.
+    void combine(const ParityHdrView& other);
 
     // These 2 used by receiver to match transmitted ParityHdr dimensions:
-    unsigned int getB() { return B; }
-    unsigned int getN() { return N; }
+    std::uint32_t getB() const { return B; }
+    std::uint32_t getN() const { return N; }
+    // and the true length of the byte array (B * N, less any zero padding):
+    std::uint64_t get_length() const { return length; }
 
-    const unsigned char* serialize() const; // User calls this prior to ParityHdr transmission.
+    // User calls this prior to ParityHdr transmission:
+    const unsigned char* serialize(Integrity integrity = Integrity::Sum) const;
+    // or, to serialize without allocating, into a caller owned buffer (e.g. right before the
+    // byte array in a send buffer) of at least serialized_size() bytes, returning bytes written:
+    std::size_t serialized_size() const;
+    std::size_t serialize_into(std::span<unsigned char> buf, Integrity integrity = Integrity::Sum) const;
     bool load_from_serialized(const unsigned char*);  // Load empty ParityHdr from received bytes.
     bool confirm_check_sum() const;   // User can confirm received ParityHdr is good to extent possible.
 
-    // Use recieved ParityHdr, rcvd_hdr,(after confirm_check_sum) and ParityHdr, t_hdr, 
-    // of received byte array, t, to fix 1 bit flip in t when rcvd_hdr != t_hdr: 
-    friend bool operator== (const ParityHdr&, const ParityHdr&);
-    friend void repair_byte_array(const ParityHdr& rcvd_hdr, const ParityHdr& t_hdr,
-      unsigned char* t);
-    friend void find_error_locations(const ParityHdr&, const ParityHdr&, int*, int*);
+    // operator==, repair_byte_array and find_error_locations (below) take ParityHdrViews,
+    // which ParityHdrs convert to implicitly.
 
     private:
+    friend class ParityHdrBuilder;
+    friend class ParityHdrView;
+    void reserve(std::uint32_t B, std::uint32_t N);  // set B, N (length B * N), growing storage as needed.
+    void release();                                  // give back the storage block.
     void calculate_parities(const unsigned char*);  // called by ctor to fill row/col_parities.
-    inline unsigned char byte_parity(unsigned char) const;
-    unsigned int calc_check_sum() const;
+    void calculate_parities(const unsigned char*, const Executor&, unsigned n_tasks);
+    std::uint64_t calc_check_sum() const;
 
-    unsigned int check_sum;  // == B + N + sum(row_parities) + sum(col_parities)
-    unsigned short B;          // Number of bytes per column.
-    unsigned short N;          // Number of columns.
+    std::uint64_t check_sum;  // == B + N + sum(row_parities) + sum(col_parities)
+    std::uint32_t B;          // Number of bytes per column.
+    std::uint32_t N;          // Number of columns.
+    std::uint64_t length;     // of the byte array, <= B * N: the rest of the B x N is zero padding.
     unsigned char* row_parities;   // in [0, 255] tracks parity of each bit row within a byte row. 
     unsigned char* col_parities;   // 0 or 1.
+    std::size_t row_capacity;      // room in the storage block for row/col_parities, >= B, N.
+    std::size_t col_capacity;      // (the block, starting at row_parities, is their sum long.)
+    std::pmr::memory_resource* resource;   // allocates the storage block.
   };
 
-  unsigned char ParityHdr::byte_parity(unsigned char c) const {
-    // returns 0 or 1 parity of byte c.
-    unsigned char p{ 0 };
-    for (int i = 0; i < 8; ++i) {
-      p ^= c & 1;
-      c >>= 1;
-    }
-    return p;
-  }
+  // A non-owning, read only view of the information in a ParityHdr: either of a ParityHdr, or of
+  // received serialized ParityHdr bytes, validated in place by load_from_serialized and then
+  // used directly from the receive buffer (which must outlive the view) without copying.
+  class ParityHdrView {
+    public:
+    ParityHdrView();
+    ParityHdrView(const ParityHdr&);  // implicit, so ParityHdrs can be used wherever views are.
+
+    std::uint32_t getB() const { return B; }
+    std::uint32_t getN() const { return N; }
+    std::uint64_t get_length() const { return length; }
+    std::span<const unsigned char> get_row_parities() const { return { row_parities, B }; }
+    std::span<const unsigned char> get_col_parities() const { return { col_parities, N }; }
+
+    // Serializes the viewed ParityHdr exactly as ParityHdr::serialize_into would:
+    std::size_t serialized_size() const;
+    std::size_t serialize_into(std::span<unsigned char> buf, Integrity integrity = Integrity::Sum) const;
+
+    // Same checks as ParityHdr::load_from_serialized (whichever Integrity it was serialized
+    // with), true if ser_PH is a good ParityHdr (of a non empty B x N, B and N both > 0):
+    bool load_from_serialized(const unsigned char* ser_PH);
+    // the same, but also false (without reading past them) unless it fits the len bytes at ser_PH:
+    bool load_from_serialized(const unsigned char* ser_PH, std::size_t len);
+    bool confirm_check_sum() const;
 
-  inline bool operator!= (const ParityHdr& lhs, const ParityHdr& rhs) { return !(lhs == rhs); }
+    // Use recieved ParityHdr, rcvd_hdr,(after confirm_check_sum) and ParityHdr, t_hdr, 
+    // of received byte array, t, to fix 1 bit flip in t when rcvd_hdr != t_hdr: 
+    friend bool operator== (const ParityHdrView&, const ParityHdrView&);
+    friend void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+      unsigned char* t, const Layout& layout);
+    friend void find_error_locations(const ParityHdrView&, const ParityHdrView&, std::size_t*, std::size_t*);
+
+    private:
+    friend class ParityHdr;
+    friend class ParityHdrBatch;
+    template <std::size_t, std::size_t> friend class FixedParityHdr;
+    ParityHdrView(std::uint64_t check_sum, std::uint32_t B, std::uint32_t N,
+      const unsigned char* row_parities, const unsigned char* col_parities);  // (unpadded.)
+    std::uint64_t calc_check_sum() const;
+
+    std::uint64_t check_sum;
+    std::uint32_t B;
+    std::uint32_t N;
+    std::uint64_t length;
+    const unsigned char* row_parities;
+    const unsigned char* col_parities;
+  };
+
+  bool operator== (const ParityHdrView& lhs, const ParityHdrView& rhs);
+  inline bool operator!= (const ParityHdrView& lhs, const ParityHdrView& rhs) { return !(lhs == rhs); }
+
+  // Builds the ParityHdr of a B * N byte array from consecutive chunks of any size, e.g. as they
+  // arrive off the network or disk, so the whole byte array need never be held in memory.
+  // Only O(B + N) running row/col parity state is kept. finish() gives the same ParityHdr the
+  // ParityHdr(B, N, byte_array) ctor would, and readies the builder for the next byte array.
+  class ParityHdrBuilder {
+    public:
+    // The running state and the finished ParityHdrs are allocated from resource:
+    ParityHdrBuilder(std::uint32_t B, std::uint32_t N,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void update(const unsigned char* chunk, std::size_t len);  // consume the next len bytes.
+    std::size_t bytes_consumed() const { return pos; }
+    ParityHdr finish();  // throws PC_Exception unless exactly B * N bytes were consumed.
+
+    private:
+    std::uint32_t B;
+    std::uint32_t N;
+    std::size_t pos;               // bytes consumed so far.
+    unsigned char col_fold;        // XOR of the bytes consumed so far of the (partial) col at pos.
+    ParityHdr hdr;                 // the running row/col parities.
+  };
+
+  // The ParityHdrs of many same shape (B x N) byte arrays, calculated by one call into one
+  // contiguous block of parity storage, which later compute calls reuse, rather than each byte
+  // array paying for its' own ParityHdr construction and allocations.
+  // Byte array k's ParityHdr is then available as the view (*this)[k].
+  class ParityHdrBatch {
+    public:
+    // (the block of parity storage is allocated from resource.)
+    ParityHdrBatch(std::uint32_t B, std::uint32_t N,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Calculate the ParityHdrs of the count byte arrays byte_arrays[0], ..., [count - 1]:
+    void compute(const unsigned char* const* byte_arrays, std::size_t count);
+    // or of the count byte arrays at base, base + stride, base + 2 * stride, ...:
+    void compute(const unsigned char* base, std::size_t stride, std::size_t count);
+    // the same, with the byte arrays split among (up to) n_tasks tasks run by executor:
+    void compute(const unsigned char* base, std::size_t stride, std::size_t count,
+      const Executor& executor, unsigned n_tasks);
+    // or by a backend (see parity_backend.hpp), the byte arrays being in its' memory:
+    void compute(const unsigned char* base, std::size_t stride, std::size_t count,
+      backend::Backend& backend);
+    // Verify the size() byte arrays at base, base + stride, ... (in backend's memory) against
+    // these ParityHdrs by backend, reporting just the bad ones (as Backend::verify):
+    bool verify(const unsigned char* base, std::size_t stride, std::vector<backend::TileReport>& bad,
+      backend::Backend& backend) const;
+
+    std::uint32_t getB() const { return B; }
+    std::uint32_t getN() const { return N; }
+    std::size_t size() const { return count; }
+    ParityHdrView operator[](std::size_t k) const;
+
+    private:
+    friend class TiledParityHdr;
+    void resize(std::size_t count);
+    void compute_one(std::size_t k, const unsigned char* byte_array);
+    void assign(std::size_t k, const ParityHdrView& hdr);  // copy hdr (of B x N) in as number k.
+
+    std::uint32_t B;
+    std::uint32_t N;
+    std::size_t count;
+    std::pmr::vector<unsigned char> parities;  // count * (B + N): each row_parities then col_parities.
+    std::pmr::vector<std::uint64_t> check_sums;
+  };
 
   // ParityChecking exceptions ctor takes a c_str accesible via what() in catch.
   class PC_Exception : public std::runtime_error {
@@ -93,8 +326,263 @@ namespace ParityChecking {
   };
 
 
-  void repair_byte_array(const ParityHdr& rcvd_hdr, const ParityHdr& t_hdr,
-    unsigned char* t);
+  // t's layout, if not the default (packed column-major), is passed to each function taking t:
+  void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+    unsigned char* t, const Layout& layout = {});
+  void find_error_locations(const ParityHdrView&, const ParityHdrView&, std::size_t*, std::size_t*);
+
+  // Fast accept/reject of a received byte array, t, of rcvd_hdr's dimensions: true exactly when
+  // ParityHdr(B, N, t) == rcvd_hdr, but without building that second ParityHdr, and returning
+  // false as soon as a block of cols has a parity mismatch. Only rcvd_hdr.get_length() bytes of
+  // t are read (any zero padding is implicit, as for the ParityHdr.) Other layouts of t (which
+  // need an unpadded rcvd_hdr, else PC_Exception) are verified in one full pass, then compared.
+  bool verify(const ParityHdrView& rcvd_hdr, const unsigned char* t, const Layout& layout = {});
+
+  // The cols and byte rows where a received byte array's parities differ from rcvd_hdr's, as
+  // collected during the verify pass, along with the XOR of the two parities of each such row
+  // (whose 1 bits mark the bit rows with parity mismatches).
+  struct ParityMismatch {
+    std::vector<std::size_t> cols;
+    std::vector<std::size_t> rows;
+    std::vector<unsigned char> row_flips;  // row_flips[k] for row rows[k].
+    bool empty() const { return cols.empty() && rows.empty(); }
+    void clear() { cols.clear(); rows.clear(); row_flips.clear(); }
+  };
+
+  // verify, also collecting all the mismatches (so without stopping early), after which t can be
+  // repaired touching only the bad byte, with no further O(B + N) search:
+  bool verify(const ParityHdrView& rcvd_hdr, const unsigned char* t, ParityMismatch& mismatch,
+    const Layout& layout = {});
+  // The same for t in segments, which must total rcvd_hdr.get_length() bytes (else PC_Exception.)
+  // Cols may straddle segment boundaries; as for a Layout, the comparison follows a full pass:
+  bool verify(const ParityHdrView& rcvd_hdr, std::span<const Segment> t);
+  bool verify(const ParityHdrView& rcvd_hdr, std::span<const Segment> t, ParityMismatch& mismatch);
+  void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+    unsigned char* t, const Layout& layout = {});
+  void find_error_locations(const ParityMismatch&, std::size_t*, std::size_t*);
+
+  // Non-throwing (noexcept) repair_byte_array and find_error_locations, for retry paths where an
+  // exception unwind per uncorrectable byte array costs too much. Each returns the status of
+  // what happened instead: Ok (repaired, or *i, *j located) or NoRepairNeeded, else the reason
+  // the throwing version would have thrown (status_message(status) being its' message) with t,
+  // *i and *j left unchanged. BadBitInPadding is a bad bit located in a zero padded ParityHdr's
+  // padding, which isn't part of t, so there is no single bad bit that can be repaired.
+  enum class RepairStatus {
+    Ok, NoRepairNeeded,
+    BadCheckSum, DimensionMismatch,               // (std::runtime_error from repair_byte_array.)
+    NoBadCol, SeveralBadCols, NoBadRow, SeveralBadRows, SeveralBadBits,  // (PC_Exception.)
+    BadBitInPadding                               // (PC_Exception from repair_byte_array.)
+  };
+  const char* status_message(RepairStatus) noexcept;
+  RepairStatus try_repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+    unsigned char* t, const Layout& layout = {}) noexcept;
+  RepairStatus try_repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+    unsigned char* t, const Layout& layout = {}) noexcept;
+  // (for t in segments, a bad bit beyond the segments gives DimensionMismatch.)
+  RepairStatus try_repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+    std::span<const Segment> t) noexcept;
+  void repair_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+    std::span<const Segment> t);
+  RepairStatus try_find_error_locations(const ParityHdrView&, const ParityHdrView&, std::size_t* i,
+    std::size_t* j) noexcept;
+  RepairStatus try_find_error_locations(const ParityMismatch&, std::size_t* i, std::size_t* j) noexcept;
+
+  // A bit of the byte array: bit row i in [0, 8*B-1] (bit 0x80 >> i % 8 of byte row i / 8), in col j.
+  struct BitLocation {
+    std::size_t i;
+    std::size_t j;
+  };
+
+  // What correct_byte_array made of the mismatches. Rather than throw as repair_byte_array does,
+  // it reports which case they are. Only a single bad bit row and col (the intersection of which
+  // is the bad bit) has a unique fewest flips explanation, so only that is corrected:
+  //  Clean         - there were no mismatches.
+  //  Corrected     - flipped holds the bit that was flipped back in t.
+  //  Ambiguous     - a bad bit rows and c bad cols, more than 1 of either: there are several
+  //                  equally few flips explaining them (e.g. the 2 x 2 case's 2 diagonals, or for
+  //                  c == 1 and a == 3, all 3 flips in the bad col, or 1 there and 2 pairing up in
+  //                  any good col.) candidates holds the a x c intersections, where the flips are
+  //                  likeliest (all of them when a == c), for the user to resolve. t is untouched.
+  //  Uncorrectable - bad bit rows but no bad cols or vice versa (even numbers of flips), or
+  //                  numbers of them that no set of flips explains, or with only intersections in
+  //                  the zero padding (of a padded ParityHdr) to explain them, which can't have
+  //                  flipped. t is untouched. Retransmit.
+  // (correct_byte_array leaves intersections in the zero padding out of candidates.)
+  struct Correction {
+    enum class Status { Clean, Corrected, Ambiguous, Uncorrectable };
+    Status status{ Status::Clean };
+    std::vector<BitLocation> flipped;
+    std::vector<BitLocation> candidates;
+  };
+
+  Correction locate_errors(const ParityMismatch&);  // as correct_byte_array, but leaving t alone.
+  Correction correct_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+    unsigned char* t, const Layout& layout = {});
+  // (Uncorrectable, flipping nothing, if t's segments don't add up to rcvd_hdr.get_length().)
+  Correction correct_byte_array(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch,
+    std::span<const Segment> t);
+  // (throws std::runtime_error as repair_byte_array does on a bad rcvd_hdr check sum or dimensions.)
+  Correction correct_byte_array(const ParityHdrView& rcvd_hdr, const ParityHdrView& t_hdr,
+    unsigned char* t, const Layout& layout = {});
+
+  // The byte range [offset, offset + length) of a byte array.
+  struct ByteRange {
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  // For selective retransmission when t can't be repaired: the parts of t holding the cols with an
+  // odd number of bad bits, i.e. the mismatched cols j as byte ranges [j*B, (j+1)*B), with runs of
+  // adjacent cols merged into one range each (in increasing offset order.) With row but no col
+  // mismatches they could be anywhere, so that is all of t. A col with an even number of flips
+  // doesn't mismatch, so re-sending just these ranges need not fix t: verify it again after the
+  // resend, and loop (as demo1 and montecarlo do), re-sending all of t if that doesn't settle it.
+  // (e.g. for B == N == 16, t[0] ^= 0x80, t[16] ^= 0x80 and t[17] ^= 0x40 leave only col 0 and bit
+  // row 9 mismatched, which reads as a single bad bit, so correct_byte_array flips a wrong one.)
+  // Ranges stop at rcvd_hdr.get_length(), as there is nothing to re-send of any zero padding.
+  std::vector<ByteRange> damaged_regions(const ParityHdrView& rcvd_hdr, const ParityMismatch& mismatch);
+
+  // The ParityHdrs of a large buffer cut into a grid of tile_B x tile_N byte array tiles, stored
+  // one after another in the buffer (tile k is the tile_size() bytes at buf + k * tile_size().)
+  // Each tile is checked and repaired independently, so up to one bit error per tile can be
+  // corrected, rather than one in the whole buffer.
+  // The tiles' parities are kept contiguously in a ParityHdrBatch, and calculated (or verified)
+  // in one pass over the buffer, split among the tasks of an Executor.
+  class TiledParityHdr {
+    public:
+    TiledParityHdr(std::uint32_t tile_B, std::uint32_t tile_N,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Calculate the tiles' ParityHdrs of buf. len must be a multiple of tile_size() (else throws
+    // PC_Exception):
+    void compute(const unsigned char* buf, std::size_t len);
+    void compute(const unsigned char* buf, std::size_t len, const Executor& executor, unsigned n_tasks);
+    void compute(const unsigned char* buf, std::size_t len, backend::Backend& backend);
+
+    std::uint32_t tile_B() const { return tiles.getB(); }
+    std::uint32_t tile_N() const { return tiles.getN(); }
+    std::size_t tile_size() const { return std::size_t{ tile_B() } * tile_N(); }
+    std::size_t tile_count() const { return tiles.size(); }
+    ParityHdrView tile(std::size_t k) const { return tiles[k]; }
+
+    // Serialized, the tiles' ParityHdrs back to back (each as ParityHdrView::serialize_into):
+    std::size_t serialized_size() const;
+    std::size_t serialize_into(std::span<unsigned char> buf, Integrity integrity = Integrity::Sum) const;
+    // false unless ser_PH is len bytes of good serialized tile_B x tile_N ParityHdrs (then loaded.)
+    bool load_from_serialized(const unsigned char* ser_PH, std::size_t len);
+
+    private:
+    friend bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t,
+      std::vector<backend::TileReport>& bad, backend::Backend& backend);
+    ParityHdrBatch tiles;
+  };
+
+  // The tiles of a received buffer with parity mismatches, and the mismatches of every tile
+  // (empty for the good ones.) Reused across verify calls to avoid reallocating.
+  struct TiledMismatch {
+    std::vector<std::size_t> bad_tiles;       // in increasing order.
+    std::vector<ParityMismatch> per_tile;     // per_tile[k] for tile k.
+  };
+
+  // verify each tile of t (of rcvd_hdr.tile_count() tiles) against its tile ParityHdr, true if
+  // they all match, with every tile's mismatches collected into mismatch:
+  bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t, TiledMismatch& mismatch);
+  bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t, TiledMismatch& mismatch,
+    const Executor& executor, unsigned n_tasks);
+  // or verify by a backend, t being in its' memory, with just the bad tiles reported into bad
+  // (with their bad bits located, for a repair where t is):
+  bool verify(const TiledParityHdr& rcvd_hdr, const unsigned char* t,
+    std::vector<backend::TileReport>& bad, backend::Backend& backend);
+  // correct_byte_array applied to each bad tile of t, giving the Correction of bad_tiles[k] as [k]:
+  std::vector<Correction> correct_byte_array(const TiledParityHdr& rcvd_hdr,
+    const TiledMismatch& mismatch, unsigned char* t);
+
+  // A ParityHdr for one fixed, compile time B x N byte array shape (e.g. a protocol's frame),
+  // with its row/col_parities held inline, so it never allocates. With B and N constants the
+  // parity loops have fixed trip counts the compiler can fully unroll/vectorize, and there are no
+  // runtime divisions. It converts to a ParityHdrView, so == and repair_byte_array etc. accept it
+  // mixed with runtime sized ParityHdrs, and it (de)serializes to/from the same wire format.
+  template <std::size_t B, std::size_t N>
+  class FixedParityHdr {
+    static_assert(B > 0 && N > 0, "FixedParityHdr needs non zero dimensions.");
+    static_assert(B <= UINT32_MAX && N <= UINT32_MAX, "FixedParityHdr dimensions must fit 32 bits.");
+
+    public:
+    FixedParityHdr() = default;  // the ParityHdr of an all zero byte array.
+    explicit FixedParityHdr(const unsigned char* byte_array) { recompute(byte_array); }
+
+    void recompute(const unsigned char* byte_array);  // for a new B * N byte array.
+    static constexpr std::uint32_t getB() { return B; }
+    static constexpr std::uint32_t getN() { return N; }
+    operator ParityHdrView() const {
+      return ParityHdrView{ check_sum, B, N, row_parities.data(), col_parities.data() };
+    }
+
+    static constexpr std::size_t serialized_size() { return SERIALIZED_FIELDS_SIZE + B + N; }
+    std::size_t serialize_into(std::span<unsigned char> buf, Integrity integrity = Integrity::Sum) const {
+      return ParityHdrView{ *this }.serialize_into(buf, integrity);
+    }
+    // As ParityHdr::load_from_serialized, but also false if ser_PH is not of an (unpadded) B x N
+    // ParityHdr.
+    bool load_from_serialized(const unsigned char* ser_PH);
+    bool confirm_check_sum() const { return check_sum == calc_check_sum(); }
+
+    private:
+    std::uint64_t calc_check_sum() const;
+
+    std::array<unsigned char, B> row_parities{};
+    std::array<unsigned char, N> col_parities{};
+    std::uint64_t check_sum{ std::uint64_t{ B } + N };
+  };
+
+  template <std::size_t B, std::size_t N>
+  void FixedParityHdr<B, N>::recompute(const unsigned char* byte_array) {
+    /* 8 bytes of each col at a time (W words, then the B % 8 tail bytes), the rows' partial
+       parities kept in words too. The parity of a col is that of all its bits, so its words just
+       fold together, popcount once. All trip counts are compile time constants. */
+    constexpr std::size_t W{ B / 8 };
+    std::array<std::uint64_t, W> row_words{};
+    row_parities.fill(0);
+    for (std::size_t j = 0; j < N; ++j) {
+      const unsigned char* col = byte_array + j * B;
+      std::uint64_t fold{ 0 };
+      for (std::size_t w = 0; w < W; ++w) {
+        std::uint64_t v;
+        std::memcpy(&v, col + 8 * w, sizeof v);
+        row_words[w] ^= v;
+        fold ^= v;
+      }
+      for (std::size_t r = 8 * W; r < B; ++r) {
+        row_parities[r] ^= col[r];
+        fold ^= col[r];
+      }
+      col_parities[j] = static_cast<unsigned char>(std::popcount(fold) & 1);
+    }
+    if constexpr (W > 0)
+      std::memcpy(row_parities.data(), row_words.data(), 8 * W);
+    check_sum = calc_check_sum();
+  }
+
+  template <std::size_t B, std::size_t N>
+  bool FixedParityHdr<B, N>::load_from_serialized(const unsigned char* ser_PH) {
+    ParityHdrView view;
+    if (!view.load_from_serialized(ser_PH) || view.B != B || view.N != N || view.length != B * N)
+      return false;
+    std::copy_n(view.row_parities, B, row_parities.begin());
+    std::copy_n(view.col_parities, N, col_parities.begin());
+    check_sum = view.check_sum;
+    return true;
+  }
+
+  template <std::size_t B, std::size_t N>
+  std::uint64_t FixedParityHdr<B, N>::calc_check_sum() const {
+    std::uint64_t chk_sum{ std::uint64_t{ B } + N };
+    for (unsigned char p : row_parities)
+      chk_sum += p;
+    for (unsigned char p : col_parities)
+      chk_sum += p;
+    return chk_sum;
+  }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "parity_file.hpp"
+#include "parity_kernels.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace ParityChecking::file {
+
+    namespace {
+        constexpr unsigned char SIDECAR_MAGIC[4]{ 'P', 'H', 'S', 'C' };
+        constexpr std::uint32_t SIDECAR_VERSION{ 1 };
+        constexpr std::size_t SIDECAR_CRC_AT{ 44 };
+
+        [[noreturn]] void fail(const char* what, const char* path) {
+            /* PC_Exception for a failed system call on path, with errno's reason. */
+            throw PC_Exception{ (std::string{ what } + " " + path + ": " + std::strerror(errno) + "\n").c_str() };
+        }
+
+        void store_le(unsigned char* p, std::uint64_t v, std::size_t n_bytes) {
+            for (std::size_t k = 0; k < n_bytes; ++k, v >>= 8)
+                p[k] = static_cast<unsigned char>(v);
+        }
+        std::uint64_t load_le(const unsigned char* p, std::size_t n_bytes) {
+            std::uint64_t v{ 0 };
+            for (std::size_t k = n_bytes; k-- > 0; )
+                v = v << 8 | p[k];
+            return v;
+        }
+
+        struct SidecarHeader {
+            std::uint64_t file_size;
+            std::uint64_t mtime;
+            std::uint32_t tile_B;
+            std::uint32_t tile_N;
+            std::uint64_t tile_count;   // whole tiles.
+            std::uint32_t tail_len;     // the partial tile's record length, 0 if none.
+
+            std::size_t tile_size() const { return std::size_t{ tile_B } * tile_N; }
+            std::size_t record_len() const { return SERIALIZED_FIELDS_SIZE + tile_B + tile_N; }
+            std::size_t n_tiles() const { return tile_count + (tail_len ? 1 : 0); }
+            std::size_t record_at(std::size_t k) const { return SIDECAR_HEADER_SIZE + k * record_len(); }
+            std::size_t sidecar_size() const { return record_at(tile_count) + tail_len; }
+            std::size_t tile_len(std::size_t k) const {
+                return k < tile_count ? tile_size() : file_size - tile_count * tile_size();
+            }
+        };
+
+        void store_header(unsigned char* p, const SidecarHeader& h) {
+            std::memcpy(p, SIDECAR_MAGIC, sizeof SIDECAR_MAGIC);
+            store_le(p + 4, SIDECAR_VERSION, 4);
+            store_le(p + 8, h.file_size, 8);
+            store_le(p + 16, h.mtime, 8);
+            store_le(p + 24, h.tile_B, 4);
+            store_le(p + 28, h.tile_N, 4);
+            store_le(p + 32, h.tile_count, 8);
+            store_le(p + 40, h.tail_len, 4);
+            store_le(p + SIDECAR_CRC_AT, kernels::crc32c(p, SIDECAR_CRC_AT), 4);
+        }
+
+        bool load_header(const unsigned char* p, std::size_t len, SidecarHeader& h) {
+            /* false unless p is a good sidecar header, of a sidecar len bytes long. */
+            if (len < SIDECAR_HEADER_SIZE || std::memcmp(p, SIDECAR_MAGIC, sizeof SIDECAR_MAGIC) != 0 ||
+                load_le(p + 4, 4) != SIDECAR_VERSION ||
+                load_le(p + SIDECAR_CRC_AT, 4) != kernels::crc32c(p, SIDECAR_CRC_AT))
+                return false;
+            h.file_size = load_le(p + 8, 8);
+            h.mtime = load_le(p + 16, 8);
+            h.tile_B = static_cast<std::uint32_t>(load_le(p + 24, 4));
+            h.tile_N = static_cast<std::uint32_t>(load_le(p + 28, 4));
+            h.tile_count = load_le(p + 32, 8);
+            h.tail_len = static_cast<std::uint32_t>(load_le(p + 40, 4));
+            return h.tile_B > 0 && h.tile_N > 0 && h.file_size / h.tile_size() == h.tile_count &&
+                (h.file_size % h.tile_size() != 0) == (h.tail_len != 0) && h.sidecar_size() == len;
+        }
+
+        void write_file(const char* path, const std::vector<unsigned char>& bytes) {
+            /* Writes bytes to path + ".tmp", synced, then renames it to path. */
+            std::string tmp = std::string{ path } + ".tmp";
+            std::FILE* f = std::fopen(tmp.c_str(), "wb");
+            if (!f)
+                fail("In write_sidecar, can't create", tmp.c_str());
+            bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size() &&
+                std::fflush(f) == 0 && ::fsync(fileno(f)) == 0;
+            ok = std::fclose(f) == 0 && ok;
+            if (!ok || std::rename(tmp.c_str(), path) != 0) {
+                int err = errno;
+                std::remove(tmp.c_str());
+                errno = err;
+                fail("In write_sidecar, can't write", path);
+            }
+        }
+
+        unsigned tasks_or_all(unsigned n_tasks) {
+            return n_tasks ? n_tasks : std::max(1U, std::thread::hardware_concurrency());
+        }
+
+        std::vector<std::size_t> tiles_touched(const SidecarHeader& h, std::span<const ByteRange> ranges) {
+            /* The tiles (in increasing order, each once) that the byte ranges overlap. */
+            std::vector<std::size_t> tiles;
+            for (const ByteRange& range : ranges) {
+                if (range.length == 0 || range.offset >= h.file_size)
+                    continue;
+                std::size_t last = std::min<std::uint64_t>(range.offset + range.length, h.file_size) - 1;
+                for (std::size_t k = range.offset / h.tile_size(); k <= last / h.tile_size(); ++k)
+                    tiles.push_back(k);
+            }
+            std::sort(tiles.begin(), tiles.end());
+            tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+            return tiles;
+        }
+
+        void write_record(const SidecarHeader& h, const unsigned char* file, std::size_t k,
+            ParityHdr& hdr, unsigned char* sidecar) {
+            /* (Re)calculates tile k's ParityHdr into its' record in the sidecar. */
+            const unsigned char* tile = file + k * h.tile_size();
+            if (k < h.tile_count) {
+                hdr.reset(h.tile_B, h.tile_N);
+                hdr.recompute(tile);
+            }
+            else
+                hdr = ParityHdr(tile, h.tile_len(k));
+            hdr.serialize_into({ sidecar + h.record_at(k), hdr.serialized_size() }, Integrity::CRC32C);
+        }
+    }
+
+    MappedFile::MappedFile(const char* path, Access access)
+        : fd{ -1 }, map{ nullptr }, len{ 0 }, mtime{ 0 } {
+        const bool writable = access == Access::ReadWrite;
+        fd = ::open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if (fd < 0)
+            fail("In MappedFile, can't open", path);
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            len = static_cast<std::size_t>(st.st_size);
+            mtime = static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000 +
+                static_cast<std::uint64_t>(st.st_mtim.tv_nsec);
+            if (len == 0)  // (mmap refuses empty mappings.)
+                return;
+            void* p = ::mmap(nullptr, len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                map = static_cast<unsigned char*>(p);
+                return;
+            }
+        }
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        fail("In MappedFile, can't map", path);
+    }
+
+    MappedFile::~MappedFile() {
+        if (map)
+            ::munmap(map, len);
+        ::close(fd);
+    }
+
+    void MappedFile::advise_sequential() const {
+        /* Advice only: failures (e.g. no transparent huge pages for this file system) are ignored. */
+        if (!map)
+            return;
+        ::madvise(map, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        ::madvise(map, len, MADV_HUGEPAGE);
+#endif
+    }
+
+    void MappedFile::sync() const {
+        if (map && ::msync(map, len, MS_SYNC) != 0)
+            throw PC_Exception{ (std::string{ "In MappedFile::sync, msync failed: " } + std::strerror(errno) + "\n").c_str() };
+    }
+
+    void MappedFile::set_mtime_ns(std::uint64_t ns) const {
+        struct timespec times[2];
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;  // (leaving the access time.)
+        times[1].tv_sec = static_cast<time_t>(ns / 1000000000);
+        times[1].tv_nsec = static_cast<long>(ns % 1000000000);
+        ::futimens(fd, times);
+    }
+
+    void write_sidecar(const char* path, const char* sidecar_path, std::uint32_t tile_B,
+        std::uint32_t tile_N, const Executor& executor, unsigned n_tasks) {
+        /* The whole tiles go through TiledParityHdr::compute, in one parallel pass over the
+           mapping, then straight out through serialize_into. */
+        if (tile_B == 0 || tile_N == 0)
+            throw PC_Exception{ "In write_sidecar, tile_B and tile_N must be non zero.\n" };
+        MappedFile file{ path, MappedFile::Access::Read };
+        file.advise_sequential();
+        SidecarHeader h{ file.size(), file.mtime_ns(), tile_B, tile_N, 0, 0 };
+        h.tile_count = h.file_size / h.tile_size();
+        TiledParityHdr tiles{ tile_B, tile_N };
+        tiles.compute(file.data(), h.tile_count * h.tile_size(), executor, tasks_or_all(n_tasks));
+        ParityHdr tail;
+        if (h.file_size % h.tile_size() != 0) {
+            tail = ParityHdr(file.data() + h.tile_count * h.tile_size(), h.tile_len(h.tile_count));
+            h.tail_len = static_cast<std::uint32_t>(tail.serialized_size());
+        }
+
+        std::vector<unsigned char> sidecar(h.sidecar_size());
+        store_header(sidecar.data(), h);
+        std::span<unsigned char> records{ sidecar.data() + SIDECAR_HEADER_SIZE, sidecar.size() - SIDECAR_HEADER_SIZE };
+        std::size_t len = tiles.serialize_into(records, Integrity::CRC32C);
+        if (h.tail_len)
+            tail.serialize_into(records.subspan(len), Integrity::CRC32C);
+        write_file(sidecar_path, sidecar);
+    }
+
+    void update_sidecar(const char* path, const char* sidecar_path, std::span<const ByteRange> ranges) {
+        MappedFile file{ path, MappedFile::Access::Read };
+        SidecarHeader h;
+        {
+            MappedFile sidecar{ sidecar_path, MappedFile::Access::ReadWrite };
+            if (!load_header(sidecar.data(), sidecar.size(), h))
+                throw PC_Exception{ "In update_sidecar, not a good sidecar file.\n" };
+            if (h.file_size == file.size()) {
+                ParityHdr hdr;
+                for (std::size_t k : tiles_touched(h, ranges))
+                    write_record(h, file.data(), k, hdr, sidecar.data());
+                h.mtime = file.mtime_ns();
+                store_header(sidecar.data(), h);
+                sidecar.sync();
+                return;
+            }
+        }
+        write_sidecar(path, sidecar_path, h.tile_B, h.tile_N);
+    }
+
+    ScrubResult scrub(const char* path, const char* sidecar_path, bool repair,
+        std::span<const ByteRange> ranges, const Executor& executor, unsigned n_tasks) {
+        /* Each task takes a contiguous run of the tiles to check, verifying each against its'
+           record, loaded (and validated) in place in the sidecar's mapping. The tiles are
+           disjoint, so tasks repair theirs concurrently, and just note each tile's outcome. */
+        MappedFile sidecar{ sidecar_path, MappedFile::Access::Read };
+        SidecarHeader h;
+        if (!load_header(sidecar.data(), sidecar.size(), h))
+            throw PC_Exception{ "In scrub, not a good sidecar file.\n" };
+        MappedFile file{ path, repair ? MappedFile::Access::ReadWrite : MappedFile::Access::Read };
+        if (file.size() != h.file_size)
+            throw PC_Exception{ "In scrub, the sidecar is of a different size file (update_sidecar first.)\n" };
+
+        ScrubResult result;
+        result.stale = file.mtime_ns() != h.mtime;
+        const bool fix = repair && !result.stale;
+        std::vector<std::size_t> tiles;
+        if (ranges.empty()) {
+            tiles.resize(h.n_tiles());
+            for (std::size_t k = 0; k < tiles.size(); ++k)
+                tiles[k] = k;
+            sidecar.advise_sequential();
+            file.advise_sequential();
+        }
+        else
+            tiles = tiles_touched(h, ranges);
+
+        enum Outcome : unsigned char { Good, BadRecord, Bad, Repaired };
+        std::vector<unsigned char> outcomes(tiles.size(), Good);
+        auto check_tiles = [&](std::size_t first, std::size_t last) {
+            ParityHdrView record;
+            ParityMismatch mismatch;
+            for (std::size_t idx = first; idx < last; ++idx) {
+                const std::size_t k = tiles[idx];
+                const std::size_t at = h.record_at(k);
+                if (!record.load_from_serialized(sidecar.data() + at, sidecar.size() - at) ||
+                    record.getB() != (k < h.tile_count ? h.tile_B : choose_shape(h.tile_len(k)).B) ||
+                    record.get_length() != h.tile_len(k)) {
+                    outcomes[idx] = BadRecord;
+                    continue;
+                }
+                unsigned char* tile = file.data() + k * h.tile_size();
+                if (verify(record, tile, mismatch))
+                    continue;
+                outcomes[idx] = Bad;
+                if (fix && correct_byte_array(record, mismatch, tile).status == Correction::Status::Corrected)
+                    outcomes[idx] = Repaired;
+            }
+        };
+        n_tasks = static_cast<unsigned>(std::min<std::size_t>(tasks_or_all(n_tasks), tiles.size()));
+        if (n_tasks <= 1)
+            check_tiles(0, tiles.size());
+        else {
+            std::size_t per_task = (tiles.size() + n_tasks - 1) / n_tasks;
+            executor(n_tasks, [&](unsigned task) {
+                check_tiles(task * per_task, std::min(tiles.size(), (task + 1) * per_task));
+            });
+        }
+
+        result.tiles_checked = tiles.size();
+        for (std::size_t idx = 0; idx < tiles.size(); ++idx) {
+            if (outcomes[idx] == BadRecord)
+                result.bad_records.push_back(tiles[idx]);
+            if (outcomes[idx] == Bad || outcomes[idx] == Repaired)
+                result.bad_tiles.push_back(tiles[idx]);
+            if (outcomes[idx] == Repaired)
+                result.repaired.push_back(tiles[idx]);
+        }
+        if (!result.repaired.empty()) {
+            file.sync();
+            file.set_mtime_ns(h.mtime);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef PARITY_FILE_HDR
+#define PARITY_FILE_HDR
+
+/*
+At rest bit rot detection and repair for large files (POSIX), with ParityChecking.
+A file is memory mapped (read in place through the page cache, with MADV_SEQUENTIAL and, where
+available, MADV_HUGEPAGE for whole file passes) and cut into tile_B x tile_N tiles, as a
+TiledParityHdr; a last partial tile gets its' own zero padded ParityHdr.
+The tiles' ParityHdrs, calculated in parallel, go in a compact sidecar file, each as the record
+ParityHdrView::serialize_into (with Integrity::CRC32C) writes, so one rotted record is detected,
+and only costs the checking of its' own tile:
+  offset  0: magic "PHSC", then u32 version (1)
+          8: u64 size of the data file,
+         16: u64 mtime of the data file (ns since the epoch) when the sidecar was written,
+         24: u32 tile_B, u32 tile_N,
+         32: u64 tile_count, the number of whole tiles,
+         40: u32 length of the last partial tile's record (0 if none),
+         44: u32 CRC-32C of bytes 0 - 43,
+         48: the tile_count whole tiles' records (each SERIALIZED_FIELDS_SIZE + tile_B + tile_N
+             bytes), then the partial tile's.
+All fields little endian.
+A scrub verifies the file's tiles against the sidecar and, with repair, corrects single bad bit
+tiles in place through a shared writable mapping. An incremental scrub takes byte ranges, and
+checks just the tiles they touch; update_sidecar likewise recalculates just the records of tiles
+a legitimate write touched.
+*/
+#include "parity_checking.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ParityChecking::file {
+
+  // A whole file mmapped read only, or read/write and shared (so writes go to the file.)
+  // Throws PC_Exception if the file can't be opened or mapped.
+  class MappedFile {
+    public:
+    enum class Access { Read, ReadWrite };
+    MappedFile(const char* path, Access access);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+    unsigned char* data() const { return map; }   // (nullptr for an empty file.)
+    std::size_t size() const { return len; }
+    std::uint64_t mtime_ns() const { return mtime; }  // as of opening.
+    void advise_sequential() const;   // MADV_SEQUENTIAL (and MADV_HUGEPAGE where available.)
+    void sync() const;                // msync the writes so far to the file.
+    void set_mtime_ns(std::uint64_t ns) const;
+
+    private:
+    int fd;
+    unsigned char* map;
+    std::size_t len;
+    std::uint64_t mtime;
+  };
+
+  constexpr std::size_t SIDECAR_HEADER_SIZE{ 48 };
+
+  // Calculates the tiles' ParityHdrs of the file at path, split among n_tasks tasks of executor
+  // (0 for std::thread::hardware_concurrency()), and writes them to the sidecar at sidecar_path
+  // (through a temporary file, renamed into place, so a crash never leaves a half written
+  // sidecar.) Throws PC_Exception on failure.
+  void write_sidecar(const char* path, const char* sidecar_path, std::uint32_t tile_B,
+    std::uint32_t tile_N, const Executor& executor = thread_executor(), unsigned n_tasks = 0);
+
+  // After a legitimate write to byte ranges of the file, recalculates the records of just the
+  // tiles they touch, and the mtime, in place in the sidecar. If the file's size has changed,
+  // the whole sidecar is rewritten (with the same tile shape) instead.
+  void update_sidecar(const char* path, const char* sidecar_path, std::span<const ByteRange> ranges);
+
+  // What a scrub found. Tiles are numbered in file order, the partial tile (if any) last.
+  struct ScrubResult {
+    bool stale{ false };   // the file's mtime isn't the sidecar's: it was modified since.
+    std::size_t tiles_checked{ 0 };
+    std::vector<std::size_t> bad_tiles;     // tiles not matching their records, in order,
+    std::vector<std::size_t> repaired;      // of which these were repaired in place,
+    std::vector<std::size_t> bad_records;   // and tiles whose sidecar records were corrupt.
+  };
+
+  // Verifies the tiles of the file at path against the sidecar, all of them if ranges is empty,
+  // else those the byte ranges touch. With repair, single bad bit tiles are corrected in place
+  // (through a writable mapping, then synced, and the file's mtime restored, as its' content is
+  // again what the sidecar describes), unless the file is stale, whose differences may be
+  // legitimate edits. Throws PC_Exception if the sidecar's header is bad or of another size file.
+  ScrubResult scrub(const char* path, const char* sidecar_path, bool repair,
+    std::span<const ByteRange> ranges = {}, const Executor& executor = thread_executor(),
+    unsigned n_tasks = 0);
+}
+
+#endif
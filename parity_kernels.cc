@@ -0,0 +1,495 @@
+#include "parity_kernels.hpp"
+#include <atomic>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PC_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define PC_NEON 1
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#include <cstring>
+#include <cstdint>
+#include <bit>
+
+
+namespace ParityChecking::kernels {
+
+    namespace {
+        using XorFn = unsigned char (*)(unsigned char*, const unsigned char*, std::size_t);
+        using MismatchFn = void (*)(const unsigned char*, const unsigned char*, std::size_t,
+            std::size_t, std::vector<std::size_t>&);
+
+        unsigned char xor_tail(unsigned char* acc, const unsigned char* src, std::size_t len,
+            unsigned char fold) {
+            /* Scalar byte at a time finish for the len < vector width tails. */
+            for (std::size_t k = 0; k < len; ++k) {
+                acc[k] ^= src[k];
+                fold ^= src[k];
+            }
+            return fold;
+        }
+
+        inline unsigned char fold_64(unsigned long long w) {
+            // horizontal XOR of the 8 bytes of w.
+            w ^= w >> 32;
+            w ^= w >> 16;
+            w ^= w >> 8;
+            return static_cast<unsigned char>(w);
+        }
+
+        unsigned char xor_accumulate_scalar(unsigned char* acc, const unsigned char* src, std::size_t len) {
+            /* For cpus without (known) SIMD: 8 bytes at a time in a 64 bit word, the fold kept as
+               a word too and only folded down to a byte at the end. (memcpy, as acc and src
+               needn't be aligned; it compiles to plain loads and stores.) */
+            unsigned long long fold{ 0 };
+            std::size_t k = 0;
+            for (; k + 8 <= len; k += 8) {
+                unsigned long long a, x;
+                std::memcpy(&a, acc + k, 8);
+                std::memcpy(&x, src + k, 8);
+                a ^= x;
+                fold ^= x;
+                std::memcpy(acc + k, &a, 8);
+            }
+            return xor_tail(acc + k, src + k, len - k, fold_64(fold));
+        }
+
+        void mismatch_tail(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t base, std::vector<std::size_t>& out) {
+            for (std::size_t k = 0; k < n; ++k)
+                if (a[k] != b[k])
+                    out.push_back(base + k);
+        }
+
+        void find_mismatches_scalar(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t base, std::vector<std::size_t>& out) {
+            // a word at a time, only looking at the bytes of words that differ.
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8) {
+                unsigned long long x, y;
+                std::memcpy(&x, a + k, 8);
+                std::memcpy(&y, b + k, 8);
+                if (x != y)
+                    mismatch_tail(a + k, b + k, 8, base + k, out);
+            }
+            mismatch_tail(a + k, b + k, n - k, base + k, out);
+        }
+
+        template <typename Mask>
+        void push_mask_bits(Mask m, std::size_t base, std::vector<std::size_t>& out) {
+            // appends base + k for each set bit k of compare mask m.
+            while (m) {
+                out.push_back(base + __builtin_ctzll(m));
+                m &= m - 1;
+            }
+        }
+
+        unsigned char fold_bytes(const unsigned char* p, std::size_t len) {
+            // horizontal XOR of the len bytes at p, a word at a time.
+            unsigned long long w{ 0 };
+            std::size_t k = 0;
+            for (; k + 8 <= len; k += 8) {
+                unsigned long long x;
+                std::memcpy(&x, p + k, 8);
+                w ^= x;
+            }
+            unsigned char fold = fold_64(w);
+            for (; k < len; ++k)
+                fold ^= p[k];
+            return fold;
+        }
+
+        std::uint64_t byte_parity_bits(const unsigned char* p, std::size_t len) {
+            // bit k is the parity of byte p[k], for the len <= 64 bytes at p. (The gather needs
+            // byte p[k + b] in byte b of w, from the low end, so w is loaded little endian.)
+            std::uint64_t bits{ 0 };
+            for (std::size_t k = 0; k < len; k += 8) {
+                std::uint64_t w{ 0 };
+                std::memcpy(&w, p + k, len - k < 8 ? len - k : 8);
+                if constexpr (std::endian::native == std::endian::big)
+                    w = __builtin_bswap64(w);
+                w ^= w >> 4;
+                w ^= w >> 2;
+                w ^= w >> 1;
+                w &= 0x0101010101010101ULL;  // parity of each byte in the low bit of that byte.
+                bits |= (w * 0x0102040810204080ULL) >> 56 << k;  // gathered into 8 adjacent bits.
+            }
+            return bits;
+        }
+
+        void tiny_col_parities(const unsigned char* cols, std::size_t B, std::size_t n_cols,
+            unsigned char* col_parities) {
+            /* Col parities for cols of fewer than 8 bytes: the parities of each 64 bytes are packed
+               into a word and prefix XORed, so bit k is the parity of all the bytes up to k, and
+               a col's parity is the prefix at its' last byte XOR the prefix at the previous col's. */
+            const std::size_t len = n_cols * B;
+            std::size_t j = 0, col_end = B - 1;
+            std::uint64_t carry{ 0 };       // parity of everything before this 64 bytes.
+            unsigned prev{ 0 };             // prefix parity at the end of col j - 1.
+            for (std::size_t base = 0; base < len; base += 64) {
+                std::size_t n = len - base < 64 ? len - base : 64;
+                std::uint64_t x = byte_parity_bits(cols + base, n);
+                x ^= x << 1;
+                x ^= x << 2;
+                x ^= x << 4;
+                x ^= x << 8;
+                x ^= x << 16;
+                x ^= x << 32;
+                x ^= 0 - carry;
+                carry = x >> 63;
+                for (; j < n_cols && col_end < base + n; ++j, col_end += B) {
+                    unsigned p = (x >> (col_end - base)) & 1;
+                    col_parities[j] = static_cast<unsigned char>(p ^ prev);
+                    prev = p;
+                }
+            }
+        }
+
+#if defined(PC_X86)
+        __attribute__((target("sse2")))
+        unsigned char fold_128(__m128i x) {
+            // horizontal XOR of the 16 bytes of x.
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 8));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 4));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 2));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 1));
+            return static_cast<unsigned char>(_mm_cvtsi128_si32(x));
+        }
+
+        __attribute__((target("sse2")))
+        unsigned char xor_accumulate_sse2(unsigned char* acc, const unsigned char* src, std::size_t len) {
+            __m128i x = _mm_setzero_si128();
+            std::size_t k = 0;
+            for (; k + 16 <= len; k += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k));
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + k));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + k), _mm_xor_si128(a, v));
+                x = _mm_xor_si128(x, v);
+            }
+            return xor_tail(acc + k, src + k, len - k, fold_128(x));
+        }
+
+        __attribute__((target("sse2")))
+        void find_mismatches_sse2(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t base, std::vector<std::size_t>& out) {
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k)));
+                push_mask_bits(static_cast<unsigned>(_mm_movemask_epi8(eq)) ^ 0xffffU, base + k, out);
+            }
+            mismatch_tail(a + k, b + k, n - k, base + k, out);
+        }
+
+        __attribute__((target("avx2")))
+        unsigned char xor_accumulate_avx2(unsigned char* acc, const unsigned char* src, std::size_t len) {
+            __m256i x = _mm256_setzero_si256();
+            std::size_t k = 0;
+            for (; k + 32 <= len; k += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k));
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + k));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + k), _mm256_xor_si256(a, v));
+                x = _mm256_xor_si256(x, v);
+            }
+            __m128i x128 = _mm_xor_si128(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+            return xor_tail(acc + k, src + k, len - k, fold_128(x128));
+        }
+
+        __attribute__((target("avx2")))
+        void find_mismatches_avx2(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t base, std::vector<std::size_t>& out) {
+            std::size_t k = 0;
+            for (; k + 32 <= n; k += 32) {
+                __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k)),
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k)));
+                push_mask_bits(~static_cast<unsigned>(_mm256_movemask_epi8(eq)), base + k, out);
+            }
+            mismatch_tail(a + k, b + k, n - k, base + k, out);
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        void find_mismatches_avx512(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t base, std::vector<std::size_t>& out) {
+            std::size_t k = 0;
+            for (; k + 64 <= n; k += 64) {
+                __mmask64 ne = _mm512_cmpneq_epu8_mask(_mm512_loadu_si512(a + k), _mm512_loadu_si512(b + k));
+                push_mask_bits(static_cast<unsigned long long>(ne), base + k, out);
+            }
+            mismatch_tail(a + k, b + k, n - k, base + k, out);
+        }
+
+        __attribute__((target("avx512f")))
+        unsigned char xor_accumulate_avx512(unsigned char* acc, const unsigned char* src, std::size_t len) {
+            __m512i x = _mm512_setzero_si512();
+            std::size_t k = 0;
+            for (; k + 64 <= len; k += 64) {
+                __m512i v = _mm512_loadu_si512(src + k);
+                __m512i a = _mm512_loadu_si512(acc + k);
+                _mm512_storeu_si512(acc + k, _mm512_xor_si512(a, v));
+                x = _mm512_xor_si512(x, v);
+            }
+            // (spilling x avoids the 512 bit extract intrinsics, which gcc warns about.)
+            alignas(64) unsigned long long w[8];
+            _mm512_store_si512(w, x);
+            unsigned long long f = w[0] ^ w[1] ^ w[2] ^ w[3] ^ w[4] ^ w[5] ^ w[6] ^ w[7];
+            return xor_tail(acc + k, src + k, len - k, fold_64(f));
+        }
+#endif
+
+#if defined(PC_NEON)
+        unsigned char xor_accumulate_neon(unsigned char* acc, const unsigned char* src, std::size_t len) {
+            uint8x16_t x = vdupq_n_u8(0);
+            std::size_t k = 0;
+            for (; k + 16 <= len; k += 16) {
+                uint8x16_t v = vld1q_u8(src + k);
+                vst1q_u8(acc + k, veorq_u8(vld1q_u8(acc + k), v));
+                x = veorq_u8(x, v);
+            }
+            uint64x2_t x64 = vreinterpretq_u64_u8(x);
+            unsigned long long w = vgetq_lane_u64(x64, 0) ^ vgetq_lane_u64(x64, 1);
+            return xor_tail(acc + k, src + k, len - k, fold_64(w));
+        }
+
+        void find_mismatches_neon(const unsigned char* a, const unsigned char* b, std::size_t n,
+            std::size_t base, std::vector<std::size_t>& out) {
+            // (NEON has no movemask, so just skip equal 16 byte blocks and rescan the others.)
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16)
+                if (vmaxvq_u8(veorq_u8(vld1q_u8(a + k), vld1q_u8(b + k))) != 0)
+                    mismatch_tail(a + k, b + k, 16, base + k, out);
+            mismatch_tail(a + k, b + k, n - k, base + k, out);
+        }
+#endif
+
+        // CRC-32C: the reflected Castagnoli polynomial, one 256 entry table for the portable path.
+        constexpr std::uint32_t CRC32C_POLY{ 0x82f63b78 };
+        struct Crc32cTable {
+            std::uint32_t t[256];
+            constexpr Crc32cTable() : t{} {
+                for (std::uint32_t b = 0; b < 256; ++b) {
+                    std::uint32_t c = b;
+                    for (int k = 0; k < 8; ++k)
+                        c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+                    t[b] = c;
+                }
+            }
+        };
+        constexpr Crc32cTable CRC32C_TABLE{};
+
+        using CrcFn = std::uint32_t (*)(std::uint32_t, const unsigned char*, std::size_t);
+
+        std::uint32_t crc32c_table(std::uint32_t c, const unsigned char* p, std::size_t len) {
+            for (std::size_t k = 0; k < len; ++k)
+                c = CRC32C_TABLE.t[(c ^ p[k]) & 0xff] ^ (c >> 8);
+            return c;
+        }
+
+#if defined(PC_X86) && defined(__x86_64__)
+        __attribute__((target("sse4.2")))
+        std::uint32_t crc32c_sse42(std::uint32_t c, const unsigned char* p, std::size_t len) {
+            unsigned long long c64 = c;
+            std::size_t k = 0;
+            for (; k + 8 <= len; k += 8) {
+                unsigned long long w;
+                std::memcpy(&w, p + k, 8);
+                c64 = _mm_crc32_u64(c64, w);
+            }
+            c = static_cast<std::uint32_t>(c64);
+            for (; k < len; ++k)
+                c = _mm_crc32_u8(c, p[k]);
+            return c;
+        }
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+        std::uint32_t crc32c_armv8(std::uint32_t c, const unsigned char* p, std::size_t len) {
+            std::size_t k = 0;
+            for (; k + 8 <= len; k += 8) {
+                std::uint64_t w;
+                std::memcpy(&w, p + k, 8);
+                c = __crc32cd(c, w);
+            }
+            for (; k < len; ++k)
+                c = __crc32cb(c, p[k]);
+            return c;
+        }
+#endif
+
+        CrcFn best_crc32c() {
+#if defined(PC_X86) && defined(__x86_64__)
+            if (__builtin_cpu_supports("sse4.2"))
+                return crc32c_sse42;
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+            return crc32c_armv8;
+#endif
+            return crc32c_table;
+        }
+
+        bool cpu_has(Isa isa) {
+            switch (isa) {
+            case Isa::Scalar:
+                return true;
+#if defined(PC_X86)
+            case Isa::SSE2:
+                return __builtin_cpu_supports("sse2");
+            case Isa::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case Isa::AVX512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+#if defined(PC_NEON)
+            case Isa::NEON:
+                return true;
+#endif
+            default:
+                return false;
+            }
+        }
+
+        struct Impl {
+            XorFn xor_fn;
+            MismatchFn mismatch_fn;
+        };
+
+        const Impl* impl_of(Isa isa) {
+            static constexpr Impl scalar{ xor_accumulate_scalar, find_mismatches_scalar };
+#if defined(PC_X86)
+            static constexpr Impl sse2{ xor_accumulate_sse2, find_mismatches_sse2 };
+            static constexpr Impl avx2{ xor_accumulate_avx2, find_mismatches_avx2 };
+            static constexpr Impl avx512{ xor_accumulate_avx512, find_mismatches_avx512 };
+#endif
+#if defined(PC_NEON)
+            static constexpr Impl neon{ xor_accumulate_neon, find_mismatches_neon };
+#endif
+            switch (isa) {
+#if defined(PC_X86)
+            case Isa::SSE2:
+                return &sse2;
+            case Isa::AVX2:
+                return &avx2;
+            case Isa::AVX512:
+                return &avx512;
+#endif
+#if defined(PC_NEON)
+            case Isa::NEON:
+                return &neon;
+#endif
+            default:
+                return &scalar;
+            }
+        }
+
+        Isa best_isa() {
+            for (Isa isa : { Isa::AVX512, Isa::AVX2, Isa::SSE2, Isa::NEON })
+                if (cpu_has(isa))
+                    return isa;
+            return Isa::Scalar;
+        }
+
+        // The dispatch state, chosen on first use (function statics so ParityHdrs constructed
+        // during static initialization of other translation units are safe.)
+        std::atomic<Isa>& current_isa() {
+            static std::atomic<Isa> isa{ best_isa() };
+            return isa;
+        }
+        std::atomic<const Impl*>& current_impl() {
+            static std::atomic<const Impl*> impl{ impl_of(current_isa().load()) };
+            return impl;
+        }
+    }
+
+    unsigned char xor_accumulate(unsigned char* acc, const unsigned char* src, std::size_t len) {
+        return current_impl().load(std::memory_order_relaxed)->xor_fn(acc, src, len);
+    }
+
+    void accumulate_cols(const unsigned char* cols, std::size_t B, std::size_t n_cols,
+        unsigned char* row_parities, unsigned char* col_parities) {
+        /* Cols shorter than SHORT_COL would leave most of each vector empty, so for them the
+           row parities are instead accumulated a superblock of whole cols (about SUPERBLOCK
+           bytes) at a time into a superblock wide accumulator, folded down to B bytes at the
+           end, and the col parities come from a plain scalar fold of each col. */
+        constexpr std::size_t SHORT_COL{ 64 };
+        constexpr std::size_t SUPERBLOCK{ 256 };
+        XorFn xor_fn = current_impl().load(std::memory_order_relaxed)->xor_fn;
+        std::size_t j = 0;
+        if (B < SHORT_COL && n_cols * B >= 2 * SUPERBLOCK) {
+            const std::size_t cols_per_block = SUPERBLOCK / B;
+            const std::size_t block = cols_per_block * B;
+            unsigned char acc[SUPERBLOCK] = {};
+            for (; j + cols_per_block <= n_cols; j += cols_per_block)
+                xor_fn(acc, cols + j * B, block);
+            for (std::size_t k = 0; k < cols_per_block; ++k)
+                for (std::size_t r = 0; r < B; ++r)
+                    row_parities[r] ^= acc[k * B + r];
+            if (B < 8)
+                tiny_col_parities(cols, B, j, col_parities);
+            else
+                for (std::size_t c = 0; c < j; ++c)
+                    col_parities[c] = parity(fold_bytes(cols + c * B, B));
+        }
+        for (; j < n_cols; ++j)
+            col_parities[j] = parity(xor_fn(row_parities, cols + j * B, B));
+    }
+
+    void accumulate_rows(const unsigned char* rows, std::size_t pitch, std::size_t B,
+        std::size_t n_cols, unsigned char* row_parities, unsigned char* col_parities) {
+        /* With rows contiguous the roles swap: each row's fold is its' row parity, and XORing the
+           rows together gives the cols' folds. The cols are taken a strip of ROW_STRIP at a time,
+           so the strip's fold accumulator stays in L1 while every row's piece of the strip is
+           XORed into it (xor_accumulate doing both), rather than streaming an n_cols accumulator
+           through the cache once per row. */
+        constexpr std::size_t ROW_STRIP{ 4096 };
+        XorFn xor_fn = current_impl().load(std::memory_order_relaxed)->xor_fn;
+        unsigned char acc[ROW_STRIP];
+        for (std::size_t j = 0; j < n_cols; j += ROW_STRIP) {
+            std::size_t width = n_cols - j < ROW_STRIP ? n_cols - j : ROW_STRIP;
+            std::memset(acc, 0, width);
+            for (std::size_t r = 0; r < B; ++r)
+                row_parities[r] ^= xor_fn(acc, rows + r * pitch + j, width);
+            for (std::size_t k = 0; k < width; ++k)
+                col_parities[j + k] = parity(acc[k]);
+        }
+    }
+
+    void find_mismatches(const unsigned char* a, const unsigned char* b, std::size_t n,
+        std::size_t base, std::vector<std::size_t>& out) {
+        current_impl().load(std::memory_order_relaxed)->mismatch_fn(a, b, n, base, out);
+    }
+
+    std::uint32_t crc32c(const unsigned char* p, std::size_t len, std::uint32_t crc) {
+        static const CrcFn crc_fn = best_crc32c();
+        return ~crc_fn(~crc, p, len);
+    }
+
+    Isa active_isa() { return current_isa().load(std::memory_order_relaxed); }
+
+    bool set_isa(Isa isa) {
+        if (!cpu_has(isa))
+            return false;
+        current_isa().store(isa, std::memory_order_relaxed);
+        current_impl().store(impl_of(isa), std::memory_order_relaxed);
+        return true;
+    }
+
+    const char* isa_name(Isa isa) {
+        switch (isa) {
+        case Isa::SSE2:
+            return "SSE2";
+        case Isa::AVX2:
+            return "AVX2";
+        case Isa::AVX512:
+            return "AVX-512";
+        case Isa::NEON:
+            return "NEON";
+        default:
+            return "Scalar";
+        }
+    }
+}
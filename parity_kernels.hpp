@@ -0,0 +1,66 @@
+#ifndef PARITY_KERNELS_HDR
+#define PARITY_KERNELS_HDR
+
+/*
+Low level parity kernels used by ParityHdr (and friends) to compute row and col parities.
+The byte array is column-major: col j is the B contiguous bytes starting at byte_array + j * B,
+so the row parities are just the XOR of all N cols, and the parity of col j is the parity of
+the XOR of its B bytes (the horizontal XOR, or "fold", of the col).
+xor_accumulate does both at once for one (piece of a) col, 16/32/64 bytes at a time, using the
+widest instruction set (SSE2/AVX2/AVX-512 on x86-64, NEON on aarch64) available on the running
+cpu, as chosen once at startup.  Every kernel produces bit-identical results.
+*/
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ParityChecking {
+  namespace kernels {
+
+    enum class Isa { Scalar, SSE2, AVX2, AVX512, NEON };
+
+    // acc[k] ^= src[k] for k in [0, len), returns the XOR of the len bytes of src.
+    unsigned char xor_accumulate(unsigned char* acc, const unsigned char* src, std::size_t len);
+
+    // Fills row_parities (B bytes) and col_parities (n_cols bytes, each 0 or 1) for the
+    // n_cols consecutive B byte cols starting at cols. row_parities is accumulated into(XORed),
+    // so zero it first for a fresh calculation.
+    void accumulate_cols(const unsigned char* cols, std::size_t B, std::size_t n_cols,
+      unsigned char* row_parities, unsigned char* col_parities);
+
+    // accumulate_cols for the same B x n_cols matrix stored row-major instead: row r is the
+    // n_cols bytes at rows + r * pitch. row_parities (B bytes) is accumulated into and
+    // col_parities (n_cols bytes) set, exactly as accumulate_cols would for the column-major copy.
+    void accumulate_rows(const unsigned char* rows, std::size_t pitch, std::size_t B,
+      std::size_t n_cols, unsigned char* row_parities, unsigned char* col_parities);
+
+    // Appends base + k to out for each k in [0, n) with a[k] != b[k], using SIMD compare masks
+    // so that runs of matching bytes cost next to nothing.
+    void find_mismatches(const unsigned char* a, const unsigned char* b, std::size_t n,
+      std::size_t base, std::vector<std::size_t>& out);
+
+    // CRC-32C (Castagnoli) of the len bytes at p, continuing from the crc of preceding bytes
+    // (so crc32c(b, n, crc32c(a, m)) is the crc of a followed by b.) Uses the SSE4.2 or ARMv8
+    // crc32c instructions when the cpu has them, else a table.
+    std::uint32_t crc32c(const unsigned char* p, std::size_t len, std::uint32_t crc = 0);
+
+    // PARITY_TABLE[c] is the 0 or 1 parity of byte c, built at compile time, so parity costs a
+    // load even on targets without a popcount instruction (where __builtin_popcount is a call.)
+    inline constexpr std::array<unsigned char, 256> PARITY_TABLE = [] {
+      std::array<unsigned char, 256> table{};
+      for (unsigned c = 1; c < 256; ++c)
+        table[c] = static_cast<unsigned char>(table[c >> 1] ^ (c & 1));
+      return table;
+    }();
+
+    // 0 or 1 parity of byte c, e.g. of a col's fold from xor_accumulate.
+    constexpr unsigned char parity(unsigned char c) { return PARITY_TABLE[c]; }
+
+    Isa active_isa();          // the Isa the kernels currently dispatch to.
+    bool set_isa(Isa);         // force an Isa (e.g. for testing), false if cpu lacks it.
+    const char* isa_name(Isa);
+  }
+}
+
+#endif
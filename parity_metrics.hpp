@@ -0,0 +1,145 @@
+#ifndef PARITY_METRICS_HDR
+#define PARITY_METRICS_HDR
+
+/*
+Optional counters on ParityChecking's hot paths: bytes through parity calculation and verify,
+ParityHdrs loaded and rejected (by reason), repair and correction outcomes (by cause) and bits
+corrected, e.g. for tuning B and N, or alerting on a rising channel error rate.
+They are compiled in only when PARITY_CHECKING_METRICS is defined, for every translation unit of
+the build alike (-DPARITY_CHECKING_METRICS); otherwise each count is an empty inline function and
+snapshot() is all zeros. With PARITY_CHECKING_METRICS_CYCLES too, the parity calculation and verify
+passes are also timed, in cycles (the time stamp counter on x86-64, the virtual counter on
+aarch64, else steady_clock ns.)
+Each thread counts into its' own cache line aligned block of atomics, written only by that thread
+with relaxed loads and stores (so no locked instructions or shared lines), and snapshot() sums
+the blocks of the running threads and the totals of those that have exited.
+*/
+#include "parity_checking.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#if defined(PARITY_CHECKING_METRICS_CYCLES)
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace ParityChecking::metrics {
+
+  // Why load_from_serialized rejected a serialized ParityHdr:
+  //  Truncated         - shorter than its' fields (or than the len given),
+  //  BadFormat         - bad magic, version or flags,
+  //  BadCriticalFields - the two copies of check_sum, B and N (or of the length) differ, or are
+  //                      inconsistent,
+  //  BadCrc, BadSum    - the CRC-32C, or the row_parities sum or check_sum, doesn't match.
+  enum class Reject { Truncated, BadFormat, BadCriticalFields, BadCrc, BadSum };
+  constexpr std::size_t N_REJECTS{ 5 };
+  constexpr std::size_t N_REPAIR_STATUSES{ static_cast<std::size_t>(RepairStatus::BadBitInPadding) + 1 };
+  constexpr std::size_t N_CORRECTION_STATUSES{ 4 };
+
+  struct Snapshot {
+    std::uint64_t bytes_hashed{ 0 };     // byte array bytes through parity calculation,
+    std::uint64_t bytes_verified{ 0 };   // through verify,
+    std::uint64_t bytes_updated{ 0 };    // and through ParityHdr::update_range.
+    std::uint64_t headers_loaded{ 0 };   // good load_from_serialized calls (1 per tile for a TiledParityHdr),
+    std::array<std::uint64_t, N_REJECTS> header_rejects{ };  // and the rest, by Reject.
+    // Bad bit locations (by find_error_locations and the repair functions), by outcome: Ok, or
+    // the cause of failure, NoBadCol to SeveralBadBits (find_error_locations' PC_Exceptions.)
+    std::array<std::uint64_t, N_REPAIR_STATUSES> locates{ };
+    // try_repair_byte_array (and so repair_byte_array) results, by RepairStatus:
+    std::array<std::uint64_t, N_REPAIR_STATUSES> repairs{ };
+    // correct_byte_array results, by Correction::Status:
+    std::array<std::uint64_t, N_CORRECTION_STATUSES> corrections{ };
+    std::uint64_t bits_corrected{ 0 };   // by repairs and corrections together.
+    std::uint64_t compute_cycles{ 0 };   // (only with PARITY_CHECKING_METRICS_CYCLES.)
+    std::uint64_t verify_cycles{ 0 };
+
+    std::uint64_t rejects() const;       // all header_rejects,
+    std::uint64_t repairs_failed() const;  // repairs neither Ok nor NoRepairNeeded.
+  };
+  // The counts since the earlier snapshot (e.g. per interval, for rates):
+  Snapshot operator- (const Snapshot& later, const Snapshot& earlier);
+
+  // The counts of all threads so far (each thread's as of about now.)
+  Snapshot snapshot();
+
+  // (ParityChecking's own counting, below.)
+  namespace detail {
+    constexpr std::size_t BYTES_HASHED{ 0 }, BYTES_VERIFIED{ 1 }, BYTES_UPDATED{ 2 }, HEADERS_LOADED{ 3 },
+      REJECTS{ 4 }, LOCATES{ REJECTS + N_REJECTS }, REPAIRS{ LOCATES + N_REPAIR_STATUSES },
+      CORRECTIONS{ REPAIRS + N_REPAIR_STATUSES }, BITS_CORRECTED{ CORRECTIONS + N_CORRECTION_STATUSES },
+      COMPUTE_CYCLES{ BITS_CORRECTED + 1 }, VERIFY_CYCLES{ COMPUTE_CYCLES + 1 }, N_COUNTERS{ VERIFY_CYCLES + 1 };
+
+    struct alignas(64) Counters {
+      std::array<std::atomic<std::uint64_t>, N_COUNTERS> counts{ };
+    };
+    Counters* register_thread() noexcept;   // the calling thread's block, on its' first count.
+    inline thread_local Counters* local{ nullptr };
+
+    inline void add(std::size_t counter, std::uint64_t n) noexcept {
+      Counters* c = local ? local : register_thread();
+      std::atomic<std::uint64_t>& count = c->counts[counter];
+      count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+#if defined(PARITY_CHECKING_METRICS_CYCLES)
+    inline std::uint64_t cycles() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#elif defined(__aarch64__)
+      std::uint64_t t;
+      asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+      return t;
+#else
+      return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+#endif
+  }
+
+#if defined(PARITY_CHECKING_METRICS)
+  inline void count_hashed(std::uint64_t n) noexcept { detail::add(detail::BYTES_HASHED, n); }
+  inline void count_verified(std::uint64_t n) noexcept { detail::add(detail::BYTES_VERIFIED, n); }
+  inline void count_updated(std::uint64_t n) noexcept { detail::add(detail::BYTES_UPDATED, n); }
+  inline void count_loaded() noexcept { detail::add(detail::HEADERS_LOADED, 1); }
+  inline void count_reject(Reject r) noexcept { detail::add(detail::REJECTS + static_cast<std::size_t>(r), 1); }
+  inline void count_locate(RepairStatus s) noexcept { detail::add(detail::LOCATES + static_cast<std::size_t>(s), 1); }
+  inline void count_repair(RepairStatus s) noexcept { detail::add(detail::REPAIRS + static_cast<std::size_t>(s), 1); }
+  inline void count_correction(Correction::Status s) noexcept {
+    detail::add(detail::CORRECTIONS + static_cast<std::size_t>(s), 1);
+  }
+  inline void count_bits_corrected(std::uint64_t n) noexcept { detail::add(detail::BITS_CORRECTED, n); }
+#else
+  inline void count_hashed(std::uint64_t) noexcept { }
+  inline void count_verified(std::uint64_t) noexcept { }
+  inline void count_updated(std::uint64_t) noexcept { }
+  inline void count_loaded() noexcept { }
+  inline void count_reject(Reject) noexcept { }
+  inline void count_locate(RepairStatus) noexcept { }
+  inline void count_repair(RepairStatus) noexcept { }
+  inline void count_correction(Correction::Status) noexcept { }
+  inline void count_bits_corrected(std::uint64_t) noexcept { }
+#endif
+
+  // Adds the cycles of its' lifetime to compute_cycles or verify_cycles (if timing is on.)
+  class ScopedCycles {
+    public:
+    enum class Pass { Compute, Verify };
+#if defined(PARITY_CHECKING_METRICS) && defined(PARITY_CHECKING_METRICS_CYCLES)
+    explicit ScopedCycles(Pass pass) noexcept
+      : counter{ pass == Pass::Compute ? detail::COMPUTE_CYCLES : detail::VERIFY_CYCLES },
+      start{ detail::cycles() } { }
+    ~ScopedCycles() { detail::add(counter, detail::cycles() - start); }
+    private:
+    std::size_t counter;
+    std::uint64_t start;
+#else
+    explicit ScopedCycles(Pass) noexcept { }
+#endif
+  };
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "pipeline.hpp"
+#include <utility>
+
+
+namespace ParityChecking::pipeline {
+
+    Pipeline::Pipeline(std::vector<Stage> stages, std::size_t depth)
+        : stages{ std::move(stages) } {
+        /* Every queue has room for all depth frames and the end marker close() sends, so only
+           acquire() (on the pool's queue) ever waits for room: that is the backpressure. */
+        if (this->stages.empty() || depth == 0)
+            throw PC_Exception{ "In Pipeline, at least one stage and a depth of at least 1 are needed.\n" };
+        for (std::size_t s = 0; s <= this->stages.size(); ++s)
+            queues.push_back(std::make_unique<SpscQueue<Frame*>>(depth + 1));
+        frames.reserve(depth);
+        for (std::size_t k = 0; k < depth; ++k) {
+            frames.push_back(std::make_unique<Frame>());
+            queues.back()->push(frames.back().get());
+        }
+        threads.reserve(this->stages.size());
+        for (std::size_t s = 0; s < this->stages.size(); ++s)
+            threads.emplace_back(&Pipeline::run_stage, this, s);
+    }
+
+    Pipeline::~Pipeline() {
+        try {
+            close();
+        }
+        catch (...) {  // (close() rethrows stage errors, which a destructor mustn't.)
+        }
+    }
+
+    Frame& Pipeline::acquire() {
+        Frame* frame = queues.back()->pop();
+        frame->status = Frame::Status::Pending;
+        frame->mismatch.clear();
+        frame->damaged.clear();
+        frame->error = nullptr;
+        return *frame;
+    }
+
+    void Pipeline::submit(Frame& frame) {
+        frame.seq = next_seq++;
+        queues.front()->push(&frame);
+    }
+
+    void Pipeline::close() {
+        /* The nullptr end marker follows the last submitted frame down the chain, each stage's
+           thread passing it on and exiting, so once they are joined every frame is through. */
+        if (closed)
+            return;
+        closed = true;
+        queues.front()->push(nullptr);
+        for (std::thread& thread : threads)
+            thread.join();
+        if (first_error)
+            std::rethrow_exception(first_error);
+    }
+
+    void Pipeline::run_stage(std::size_t s) {
+        SpscQueue<Frame*>& in = *queues[s];
+        SpscQueue<Frame*>& out = *queues[s + 1];
+        const bool last = s + 1 == stages.size();
+        for (;;) {
+            Frame* frame = in.pop();
+            if (frame) {
+                try {
+                    stages[s](*frame);
+                }
+                catch (...) {
+                    if (!frame->error)
+                        frame->error = std::current_exception();
+                }
+                if (last && frame->error && !first_error)
+                    first_error = frame->error;
+            }
+            out.push(frame);
+            if (!frame)
+                return;
+        }
+    }
+
+    Stage compute_stage(Integrity integrity) {
+        return [integrity](Frame& frame) {
+            if (frame.error)
+                return;
+            frame.hdr.recompute(frame.payload.data(), frame.payload.size());  // (in the Frame's storage.)
+            frame.hdr_ser.resize(frame.hdr.serialized_size());
+            frame.hdr.serialize_into(frame.hdr_ser, integrity);
+        };
+    }
+
+    Stage verify_stage() {
+        return [](Frame& frame) {
+            /* As demo1_main.cc's receiver, but leaving any re-sending to the caller's stages. */
+            if (frame.error)
+                return;
+            ParityHdrView rcvd_hdr;
+            if (!rcvd_hdr.load_from_serialized(frame.hdr_ser.data(), frame.hdr_ser.size()) ||
+                rcvd_hdr.get_length() != frame.payload.size()) {
+                frame.status = Frame::Status::BadHeader;
+                return;
+            }
+            if (verify(rcvd_hdr, frame.payload.data(), frame.mismatch)) {
+                frame.status = Frame::Status::Verified;
+                return;
+            }
+            if (correct_byte_array(rcvd_hdr, frame.mismatch, frame.payload.data()).status ==
+                Correction::Status::Corrected) {
+                frame.status = Frame::Status::Corrected;
+                return;
+            }
+            frame.damaged = damaged_regions(rcvd_hdr, frame.mismatch);
+            frame.status = Frame::Status::Damaged;
+        };
+    }
+}
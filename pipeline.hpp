@@ -0,0 +1,150 @@
+#ifndef PARITY_PIPELINE_HDR
+#define PARITY_PIPELINE_HDR
+
+/*
+Pipelined sending and receiving of many byte arrays (messages), so parity calculation, I/O and
+verification overlap instead of taking turns: while message k is on the wire, message k + 1's
+ParityHdr is being calculated and message k - 1 verified, each stage on its' own thread.
+A Pipeline is a chain of Stages (callbacks, each run on a Frame by one thread in turn) joined by
+bounded lock free single producer single consumer queues. A fixed pool of depth Frames
+circulates: acquire() hands out a free one (blocking while all depth are in flight, which is the
+backpressure), submit() starts it down the chain, and after the last stage it is recycled.
+A typical sender is { compute_stage(), <send the frame> }, a receiver { <receive a frame>,
+verify_stage(), <deliver or re-request it> }; demo: pipeline_main.cc.
+*/
+#include "parity_checking.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ParityChecking::pipeline {
+
+  // A bounded, lock free queue for exactly one producer and one consumer thread: a power of 2
+  // ring of slots, whose head and tail indexes are each written by only one side (and on their
+  // own cache lines, along with each side's cached copy of the other's, so most pushes and pops
+  // touch no shared line at all.) The blocking push/pop wait (std::atomic::wait, so without
+  // spinning a core) while the queue is full/empty.
+  template <typename T>
+  class SpscQueue {
+    public:
+    explicit SpscQueue(std::size_t capacity)
+      : slots(std::bit_ceil(std::max<std::size_t>(capacity, 2))), mask{ slots.size() - 1 } { }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator= (const SpscQueue&) = delete;
+
+    std::size_t capacity() const { return slots.size(); }
+
+    bool try_push(T& v) {  // (v is moved from only on success.)
+      const std::size_t t = tail.load(std::memory_order_relaxed);
+      if (t - producer_head == slots.size()) {
+        producer_head = head.load(std::memory_order_acquire);
+        if (t - producer_head == slots.size())
+          return false;
+      }
+      slots[t & mask] = std::move(v);
+      tail.store(t + 1, std::memory_order_release);
+      tail.notify_one();
+      return true;
+    }
+
+    bool try_pop(T& v) {
+      const std::size_t h = head.load(std::memory_order_relaxed);
+      if (h == consumer_tail) {
+        consumer_tail = tail.load(std::memory_order_acquire);
+        if (h == consumer_tail)
+          return false;
+      }
+      v = std::move(slots[h & mask]);
+      head.store(h + 1, std::memory_order_release);
+      head.notify_one();
+      return true;
+    }
+
+    void push(T v) {
+      while (!try_push(v))
+        head.wait(producer_head, std::memory_order_acquire);  // until the consumer pops.
+    }
+
+    T pop() {
+      T v;
+      while (!try_pop(v))
+        tail.wait(consumer_tail, std::memory_order_acquire);  // until the producer pushes.
+      return v;
+    }
+
+    private:
+    std::vector<T> slots;
+    const std::size_t mask;
+    alignas(64) std::atomic<std::size_t> head{ 0 };   // next slot to pop (written by the consumer.)
+    std::size_t consumer_tail{ 0 };                  // the consumer's last look at tail.
+    alignas(64) std::atomic<std::size_t> tail{ 0 };   // next slot to push (written by the producer.)
+    std::size_t producer_head{ 0 };                  // the producer's last look at head.
+  };
+
+  // One message in flight, with the buffers the stages fill in. Frames are reused, so their
+  // buffers keep their capacity from message to message.
+  struct Frame {
+    // What verify_stage made of the received frame:
+    //  Verified  - payload matched hdr_ser, and Corrected - it did after correct_byte_array.
+    //  BadHeader - hdr_ser isn't a good serialized ParityHdr (re-send it.)
+    //  Damaged   - payload couldn't be repaired: damaged holds the byte ranges to re-send.
+    enum class Status { Pending, Verified, Corrected, BadHeader, Damaged };
+
+    std::uint64_t seq{ 0 };                 // submission number, set by submit().
+    std::vector<unsigned char> payload;     // the byte array, as sent (or as received.)
+    ParityHdr hdr;                          // payload's ParityHdr (sending side.)
+    std::vector<unsigned char> hdr_ser;     // it serialized, as sent (or as received.)
+    Status status{ Status::Pending };
+    ParityMismatch mismatch;
+    std::vector<ByteRange> damaged;
+    std::exception_ptr error;   // set if a stage threw on this frame; later stages still see it.
+    std::shared_ptr<void> user; // anything else a caller's stages need per frame.
+  };
+
+  using Stage = std::function<void(Frame&)>;
+
+  class Pipeline {
+    public:
+    // Starts a thread per stage, with depth Frames (the most in flight at once) in the pool.
+    explicit Pipeline(std::vector<Stage> stages, std::size_t depth = 8);
+    ~Pipeline();  // close()s, if not already.
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator= (const Pipeline&) = delete;
+
+    // On the one submitting thread: take a free Frame, waiting while none is, fill it in, and
+    // submit it. Frames come out of the last stage in submission order.
+    Frame& acquire();
+    void submit(Frame& frame);
+    // Waits for every submitted Frame to finish the last stage, then stops the threads (no more
+    // acquire or submit), rethrowing the first exception a Frame finished with (see error), if any.
+    void close();
+
+    private:
+    void run_stage(std::size_t s);
+
+    std::vector<Stage> stages;
+    std::vector<std::unique_ptr<Frame>> frames;
+    // queues[s] feeds stage s, and queues[stages.size()] takes finished frames back to the pool.
+    std::vector<std::unique_ptr<SpscQueue<Frame*>>> queues;
+    std::vector<std::thread> threads;
+    std::uint64_t next_seq{ 0 };
+    bool closed{ false };
+    std::exception_ptr first_error;  // (written by the last stage's thread only.)
+  };
+
+  // The standard sending stage: payload's ParityHdr (any length, in the choose_shape shape) into
+  // hdr, serialized into hdr_ser with integrity.
+  Stage compute_stage(Integrity integrity = Integrity::CRC32C);
+  // The standard receiving stage: hdr_ser loaded, payload verified against it and corrected if
+  // that is possible, setting status (and damaged.) Frames carrying an error are skipped.
+  Stage verify_stage();
+}
+
+#endif
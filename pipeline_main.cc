@@ -0,0 +1,192 @@
+#include "pipeline.hpp"
+#include "channel_sim.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+The demo1_main.cc protocol over a simulated link, run first sequentially (each message's ParityHdr
+calculated, sent, the message sent, verified and delivered before the next is started) and then
+pipelined, each step on its' own thread with up to depth messages in flight:
+  compute_stage()  - the message's ParityHdr, serialized with a CRC-32C,
+  link             - the ParityHdr sent (through an IID noisy channel) until received intact, then
+                     the message,
+  verify_stage()   - the message verified against the received ParityHdr, and corrected,
+  deliver          - damaged regions re-sent over the link until it verifies, then checked against
+                     what was sent.
+The link has a fixed rate (sleeping out each send's wire time), and is shared by link and
+deliver's re-sends. The pipelined run keeps it busy while the other stages work.
+Usage: pipeline [messages (default 400)] [message bytes (default 262144)] [link MB/s (default 2000)]
+                [error rate (default 1e-6)] [depth (default 8)]
+  g++ -std=c++20 -O2 -pthread pipeline_main.cc pipeline.cc parity_checking.cc parity_kernels.cc channel_sim.cc -o pipeline
+*/
+
+using ParityChecking::channel::IidChannel;
+using ParityChecking::channel::Xoshiro256;
+using ParityChecking::pipeline::Frame;
+using ParityChecking::pipeline::Stage;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr int MAX_HDR_TRYS{ 30 };
+    constexpr int MAX_TRYS{ 30 };
+
+    // A link of a fixed rate: a send takes (waits out) its' wire time after any sends before it.
+    class Link {
+        public:
+        explicit Link(double bytes_per_sec) : rate{ bytes_per_sec } { }
+
+        void send(std::size_t len) {
+            Clock::time_point done;
+            {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto wire_time = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(static_cast<double>(len) / rate));
+                free_at = std::max(free_at, Clock::now()) + wire_time;
+                busy += wire_time;
+                done = free_at;
+            }
+            std::this_thread::sleep_until(done);
+        }
+
+        double busy_seconds() const { return std::chrono::duration<double>(busy).count(); }
+
+        private:
+        std::mutex mutex;
+        const double rate;
+        Clock::time_point free_at{ };
+        Clock::duration busy{ 0 };
+    };
+
+    struct Stats {
+        std::uint64_t hdr_resends{ 0 };  // (written by link only,)
+        std::uint64_t resends{ 0 };      // (and these by deliver only.)
+        std::uint64_t corrected{ 0 };
+        std::uint64_t delivered{ 0 };
+        std::uint64_t residual{ 0 };
+        std::uint64_t failed{ 0 };
+    };
+
+    void fill_message(std::uint64_t seq, unsigned char* buf, std::size_t len) {
+        /* Message seq's (reproducible) content, so deliver can re-send and check it. */
+        Xoshiro256 rng{ 7, seq };
+        for (std::size_t k = 0; k < len; k += 8) {
+            std::uint64_t r = rng();
+            std::memcpy(buf + k, &r, std::min<std::size_t>(8, len - k));
+        }
+    }
+
+    std::vector<Stage> make_stages(Link& link, const IidChannel& channel, Stats& stats) {
+        Stage link_stage = [&link, &channel, &stats, rng = Xoshiro256{ 1 },
+            sent_ser = std::vector<unsigned char>{ }](Frame& frame) mutable {
+            sent_ser = frame.hdr_ser;
+            ParityChecking::ParityHdrView rcvd_hdr;
+            for (int n_transmits = 1; ; ++n_transmits) {
+                std::memcpy(frame.hdr_ser.data(), sent_ser.data(), sent_ser.size());
+                channel.apply(frame.hdr_ser.data(), frame.hdr_ser.size(), rng);
+                link.send(frame.hdr_ser.size());
+                if (rcvd_hdr.load_from_serialized(frame.hdr_ser.data(), frame.hdr_ser.size()) ||
+                    n_transmits >= MAX_HDR_TRYS)
+                    break;
+                ++stats.hdr_resends;
+            }
+            channel.apply(frame.payload.data(), frame.payload.size(), rng);
+            link.send(frame.payload.size());
+        };
+
+        Stage deliver = [&link, &channel, &stats, rng = Xoshiro256{ 2 }, verify = ParityChecking::pipeline::verify_stage(),
+            s = std::vector<unsigned char>{ }](Frame& frame) mutable {
+            s.resize(frame.payload.size());
+            fill_message(frame.seq, s.data(), s.size());
+            for (int n_trys = 1; frame.status == Frame::Status::Damaged && n_trys < MAX_TRYS; ++n_trys) {
+                for (const ParityChecking::ByteRange& region : frame.damaged) {
+                    std::memcpy(frame.payload.data() + region.offset, s.data() + region.offset, region.length);
+                    channel.apply(frame.payload.data() + region.offset, region.length, rng);
+                    link.send(region.length);
+                }
+                ++stats.resends;
+                verify(frame);
+            }
+            if (frame.status == Frame::Status::Verified || frame.status == Frame::Status::Corrected) {
+                stats.corrected += frame.status == Frame::Status::Corrected;
+                if (std::memcmp(frame.payload.data(), s.data(), s.size()) == 0)
+                    ++stats.delivered;
+                else
+                    ++stats.residual;
+            }
+            else
+                ++stats.failed;
+        };
+
+        return { ParityChecking::pipeline::compute_stage(), std::move(link_stage),
+            ParityChecking::pipeline::verify_stage(), std::move(deliver) };
+    }
+
+    void report(const char* what, double seconds, const Link& link, const Stats& stats, std::size_t len) {
+        std::printf("%-22s %8.1f MB/s delivered, link busy %5.1f%%, %llu delivered (%llu corrected), "
+            "%llu re-sends + %llu header re-sends, %llu residual, %llu failed\n", what,
+            static_cast<double>(stats.delivered * len) / seconds / 1e6, 100.0 * link.busy_seconds() / seconds,
+            static_cast<unsigned long long>(stats.delivered), static_cast<unsigned long long>(stats.corrected),
+            static_cast<unsigned long long>(stats.resends), static_cast<unsigned long long>(stats.hdr_resends),
+            static_cast<unsigned long long>(stats.residual), static_cast<unsigned long long>(stats.failed));
+    }
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t n_messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 400;
+    std::size_t len = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256 << 10;
+    double link_rate = 1e6 * (argc > 3 ? std::strtod(argv[3], nullptr) : 2000);
+    double error_rate = argc > 4 ? std::strtod(argv[4], nullptr) : 1e-6;
+    std::size_t depth = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 8;
+    if (n_messages == 0 || len == 0 || link_rate <= 0 || depth == 0) {
+        std::fprintf(stderr, "usage: pipeline [messages] [message bytes] [link MB/s] [error rate] [depth]\n");
+        return 2;
+    }
+    const IidChannel channel{ error_rate };
+
+    try {
+        {
+            Link link{ link_rate };
+            Stats stats;
+            std::vector<Stage> stages = make_stages(link, channel, stats);
+            Frame frame;
+            auto start = Clock::now();
+            for (std::uint64_t k = 0; k < n_messages; ++k) {
+                frame.seq = k;
+                frame.payload.resize(len);
+                fill_message(k, frame.payload.data(), len);
+                frame.status = Frame::Status::Pending;
+                frame.damaged.clear();
+                for (Stage& stage : stages)
+                    stage(frame);
+            }
+            report("sequential:", std::chrono::duration<double>(Clock::now() - start).count(), link, stats, len);
+        }
+        {
+            Link link{ link_rate };
+            Stats stats;
+            auto start = Clock::now();
+            ParityChecking::pipeline::Pipeline pipeline{ make_stages(link, channel, stats), depth };
+            for (std::uint64_t k = 0; k < n_messages; ++k) {
+                Frame& frame = pipeline.acquire();
+                frame.payload.resize(len);
+                fill_message(k, frame.payload.data(), len);  // (seq will be k.)
+                pipeline.submit(frame);
+            }
+            pipeline.close();
+            char what[48];
+            std::snprintf(what, sizeof(what), "pipelined (depth %zu):", depth);
+            report(what, std::chrono::duration<double>(Clock::now() - start).count(), link, stats, len);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "pipeline: %s", e.what());
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "parity_file.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+Sidecar parity files for at rest bit rot detection and repair of large files:
+  sidecar create <file> [tile_B tile_N [threads]]   writes <file>.phsc (default 256 x 256 tiles)
+  sidecar scrub <file> [--repair] [offset:length ...]
+      verifies <file> against <file>.phsc (just the tiles of the byte ranges given, if any), and
+      with --repair, fixes single bad bit tiles in place.
+  sidecar update <file> offset:length ...
+      after legitimately writing those byte ranges of <file>, updates their tiles in <file>.phsc.
+Exit status: 0 if all is well (or was repaired), 1 if bad tiles or records remain, 2 on errors.
+  g++ -std=c++20 -O2 -pthread sidecar_main.cc parity_file.cc parity_checking.cc parity_kernels.cc -o sidecar
+*/
+
+using ParityChecking::ByteRange;
+
+namespace {
+    int usage() {
+        std::fprintf(stderr, "usage: sidecar create <file> [tile_B tile_N [threads]]\n"
+            "       sidecar scrub <file> [--repair] [offset:length ...]\n"
+            "       sidecar update <file> offset:length ...\n");
+        return 2;
+    }
+
+    bool parse_range(const char* arg, ByteRange& range) {
+        char* end;
+        range.offset = std::strtoull(arg, &end, 0);
+        if (end == arg || *end != ':')
+            return false;
+        const char* len = end + 1;
+        range.length = std::strtoull(len, &end, 0);
+        return end != len && *end == '\0';
+    }
+
+    void print_tiles(const char* what, const std::vector<std::size_t>& tiles) {
+        if (tiles.empty())
+            return;
+        std::printf("%s:", what);
+        for (std::size_t k : tiles)
+            std::printf(" %zu", k);
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3)
+        return usage();
+    const std::string command = argv[1];
+    const char* path = argv[2];
+    const std::string sidecar_path = std::string{ path } + ".phsc";
+    try {
+        if (command == "create") {
+            if (argc != 3 && argc != 5 && argc != 6)
+                return usage();
+            auto tile_B = static_cast<std::uint32_t>(argc > 3 ? std::strtoul(argv[3], nullptr, 0) : 256);
+            auto tile_N = static_cast<std::uint32_t>(argc > 4 ? std::strtoul(argv[4], nullptr, 0) : 256);
+            unsigned threads = argc > 5 ? static_cast<unsigned>(std::strtoul(argv[5], nullptr, 0)) : 0;
+            ParityChecking::file::write_sidecar(path, sidecar_path.c_str(), tile_B, tile_N,
+                ParityChecking::thread_executor(), threads);
+            return 0;
+        }
+
+        bool repair = false;
+        std::vector<ByteRange> ranges;
+        for (int a = 3; a < argc; ++a) {
+            ByteRange range;
+            if (command == "scrub" && std::strcmp(argv[a], "--repair") == 0)
+                repair = true;
+            else if (parse_range(argv[a], range))
+                ranges.push_back(range);
+            else
+                return usage();
+        }
+        if (command == "update") {
+            if (ranges.empty())
+                return usage();
+            ParityChecking::file::update_sidecar(path, sidecar_path.c_str(), ranges);
+            return 0;
+        }
+        if (command != "scrub")
+            return usage();
+
+        auto result = ParityChecking::file::scrub(path, sidecar_path.c_str(), repair, ranges);
+        std::printf("%zu tiles checked, %zu bad, %zu repaired, %zu bad records\n", result.tiles_checked,
+            result.bad_tiles.size(), result.repaired.size(), result.bad_records.size());
+        if (result.stale)
+            std::printf("%s was modified since its' sidecar was written%s\n", path,
+                repair ? " (so nothing was repaired: update or recreate the sidecar)" : "");
+        print_tiles("bad tiles", result.bad_tiles);
+        print_tiles("repaired", result.repaired);
+        print_tiles("bad records", result.bad_records);
+        return result.bad_tiles.size() == result.repaired.size() && result.bad_records.empty() ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "sidecar: %s", e.what());
+        return 2;
+    }
+}